@@ -0,0 +1,24 @@
+#!/bin/sh
+#
+# Compares two benchmark reports written by "make bench":
+#
+#       bench-compare.sh OLD NEW
+#
+# and prints average cycles of every benchmark in both with the relative change.
+#
+
+if [ $# -ne 2 ]; then
+	echo "usage: $0 OLD NEW" >&2
+	exit 2
+fi
+
+awk '
+/^#/ { next }
+FNR == NR { old[$1] = $4; next }
+{
+	if ($1 in old && old[$1] > 0)
+		printf "%-24s %8d %8d %+7.1f%%\n", $1, old[$1], $4, ($4 - old[$1]) * 100.0 / old[$1]
+	else
+		printf "%-24s %8s %8d\n", $1, "-", $4
+}
+' "$1" "$2"
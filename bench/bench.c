@@ -0,0 +1,426 @@
+/*
+ * Copyright (c) 2018 Sereda Anton
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ */
+
+/*
+ * Benchmark firmware. It is run under simavr by "make bench", every benchmark is timed
+ * with Timer/Counter1 (one tick per CPU cycle) and results are printed on UART0 as
+ *
+ *      bench <name> <n_samples> <min> <avg> <max>
+ *
+ * with all numbers in CPU cycles. Interrupts are disabled while a sample is taken.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <avr/pgmspace.h>
+#include <avr/sleep.h>
+#include <util/atomic.h>
+
+#include "hrtimer.h"
+#include "fifo-buffer.h"
+#include "uart.h"
+#include "crc16.h"
+#include "frame.h"
+#include "modbus-rtu.h"
+#include "dhtxx.h"
+
+#ifndef BENCH_UART_PARAMS
+#define BENCH_UART_PARAMS       "UART0:115200@8N1"
+#endif
+
+/* NOTE: ISR benchmarks drive a port that is not used for the report */
+#ifndef BENCH_ISR_UART_PARAMS
+#define BENCH_ISR_UART_PARAMS   "UART1:115200@8N1"
+#endif
+
+#define BENCH_N_SAMPLES 64u
+
+/*
+ * NOTE: ISRs are called as plain functions and they end with RETI, which sets I bit.
+ *       Interrupts are disabled again right after the call, yet a pending one may run
+ *       in between and get into the sample.
+ */
+void USART1_RX_vect(void);
+void USART1_UDRE_vect(void);
+
+struct bench_stats {
+        uint32_t total;
+        uint16_t count;
+
+        uint16_t min;
+        uint16_t max;
+};
+
+/* Cost of an empty measurement, it is subtracted from every sample */
+static uint16_t overhead = 0u;
+
+static struct uart report_uart;
+static struct uart isr_uart;
+
+#define BENCH_BEGIN()                                                           \
+        uint8_t _bench_sreg = SREG;                                             \
+        uint16_t _bench_start = 0u;                                             \
+                                                                                \
+        cli();                                                                  \
+        _bench_start = hrtimer_now()
+
+#define BENCH_END(stats)                                                        \
+        do {                                                                    \
+                uint16_t _bench_cycles = hrtimer_elapsed(_bench_start);         \
+                                                                                \
+                SREG = _bench_sreg;                                             \
+                bench_record((stats), _bench_cycles);                           \
+        } while (0)
+
+static void bench_clear(struct bench_stats *stats)
+{
+        memset(stats, 0, sizeof(struct bench_stats));
+
+        stats->min = UINT16_MAX;
+}
+
+static void bench_record(struct bench_stats *stats, uint16_t cycles)
+{
+        cycles = (cycles > overhead) ? (uint16_t) (cycles - overhead) : 0u;
+
+        stats->total += cycles;
+        stats->count++;
+
+        if (cycles < stats->min)
+                stats->min = cycles;
+
+        if (cycles > stats->max)
+                stats->max = cycles;
+}
+
+static void bench_report(const char *name, struct bench_stats *stats)
+{
+        uint16_t avg = 0u;
+
+
+        if (stats->count != 0u)
+                avg = (uint16_t) (stats->total / stats->count);
+
+        printf_P(PSTR("bench %S %u %u %u %u\n"), name, stats->count, stats->min, avg, stats->max);
+}
+
+static void bench_calibrate(void)
+{
+        struct bench_stats stats;
+        uint16_t i = 0u;
+
+
+        bench_clear(&stats);
+        overhead = 0u;
+
+        for (; i < BENCH_N_SAMPLES; ++i) {
+                BENCH_BEGIN();
+                BENCH_END(&stats);
+        }
+
+        overhead = stats.min;
+}
+
+static void bench_fifo(void)
+{
+        static uint8_t buf[16];
+        struct fifo_buffer fifo;
+        struct bench_stats put_stats;
+        struct bench_stats get_stats;
+        uint8_t byte = 0u;
+        uint16_t i = 0u;
+
+
+        bench_clear(&put_stats);
+        bench_clear(&get_stats);
+        fifo_buffer_init(&fifo, buf, sizeof(buf));
+
+        for (; i < BENCH_N_SAMPLES; ++i) {
+                {
+                        BENCH_BEGIN();
+                        fifo_buffer_put_byte(&fifo, (uint8_t) i);
+                        BENCH_END(&put_stats);
+                }
+
+                {
+                        BENCH_BEGIN();
+                        fifo_buffer_get_byte(&fifo, &byte);
+                        BENCH_END(&get_stats);
+                }
+        }
+
+        bench_report(PSTR("fifo_put_byte"), &put_stats);
+        bench_report(PSTR("fifo_get_byte"), &get_stats);
+}
+
+static void bench_uart_isr(void)
+{
+        struct bench_stats rx_stats;
+        struct bench_stats udre_stats;
+        struct uart_hw *hw = NULL;
+        uint8_t byte = 0u;
+        uint16_t i = 0u;
+
+
+        bench_clear(&rx_stats);
+        bench_clear(&udre_stats);
+        hw = isr_uart.hw;
+
+        for (; i < BENCH_N_SAMPLES; ++i) {
+                /* NOTE: Drained report UART has no UDRE interrupt pending to slip in after RETI */
+                uart_flush(&report_uart);
+
+                {
+                        BENCH_BEGIN();
+                        USART1_RX_vect();
+                        cli();
+                        BENCH_END(&rx_stats);
+                }
+
+                fifo_buffer_get_byte(&hw->rx_fifo, &byte);
+                fifo_buffer_put_byte(&hw->tx_fifo, byte);
+                uart_flush(&report_uart);
+
+                {
+                        BENCH_BEGIN();
+                        USART1_UDRE_vect();
+                        cli();
+                        BENCH_END(&udre_stats);
+                }
+        }
+
+        bench_report(PSTR("uart_rx_isr"), &rx_stats);
+        bench_report(PSTR("uart_udre_isr"), &udre_stats);
+}
+
+static void bench_crc16(void)
+{
+        static uint8_t const req[] = { 0x01, 0x03, 0x00, 0x00, 0x00, 0x0a };
+        struct bench_stats byte_stats;
+        struct bench_stats req_stats;
+        uint16_t crc_reg = CRC16_REG_INITIALIZER;
+        uint16_t i = 0u;
+
+
+        bench_clear(&byte_stats);
+        bench_clear(&req_stats);
+
+        for (; i < BENCH_N_SAMPLES; ++i) {
+                {
+                        BENCH_BEGIN();
+                        crc16_byte(&crc_reg, (uint8_t) i);
+                        BENCH_END(&byte_stats);
+                }
+
+                crc_reg = CRC16_REG_INITIALIZER;
+
+                {
+                        BENCH_BEGIN();
+                        crc16_update(&crc_reg, req, sizeof(req));
+                        BENCH_END(&req_stats);
+                }
+        }
+
+        bench_report(PSTR("crc16_byte"), &byte_stats);
+        bench_report(PSTR("modbus_req_crc"), &req_stats);
+}
+
+static void bench_frame(void)
+{
+        static uint8_t payload[FRAME_MAX_PAYLOAD_SIZE];
+        static uint8_t buf[FRAME_MAX_ENCODED_SIZE];
+        static struct frame_decoder dec;
+        struct frame_encoder enc;
+        struct mem_chunk out;
+        struct frame frame;
+        struct bench_stats encode_stats;
+        struct bench_stats decode_stats;
+        size_t j = 0u;
+        uint16_t i = 0u;
+
+
+        bench_clear(&encode_stats);
+        bench_clear(&decode_stats);
+        frame_encoder_init(&enc);
+        frame_decoder_init(&dec);
+
+        for (; j < sizeof(payload); ++j)
+                payload[j] = (uint8_t) (j * 7u);
+
+        for (; i < BENCH_N_SAMPLES; ++i) {
+                mem_chunk_set(&out, buf, sizeof(buf));
+
+                {
+                        BENCH_BEGIN();
+                        frame_encode(&enc, FRAME_TYPE_SAMPLES, payload, sizeof(payload), &out);
+                        BENCH_END(&encode_stats);
+                }
+
+                {
+                        BENCH_BEGIN();
+                        for (j = 0u; j < out.size; ++j)
+                                frame_decoder_push(&dec, buf[j], &frame);
+                        BENCH_END(&decode_stats);
+                }
+        }
+
+        bench_report(PSTR("frame_encode_64"), &encode_stats);
+        bench_report(PSTR("frame_decode_64"), &decode_stats);
+}
+
+static uint8_t modbus_resp_bytes[] = { 0x01, 0x03, 0x04, 0x00, 0x0a, 0x00, 0x0b, 0x00, 0x00 };
+static size_t modbus_resp_offset = 0u;
+
+static bool modbus_bench_recv(struct modbus_rtu *rtu, struct modbus_rtu_async *async)
+{
+        struct mem_chunk *chunk = NULL;
+        size_t size = 0u;
+
+
+        /* NOTE: Whole response is already "received", so every state completes at once */
+        chunk = &async->chunk;
+        size = chunk->size - chunk->offset;
+
+        memcpy((uint8_t *) chunk->ptr + chunk->offset, &modbus_resp_bytes[modbus_resp_offset], size);
+        chunk->offset += size;
+        modbus_resp_offset += size;
+
+
+        return true;
+}
+
+static void bench_modbus(void)
+{
+        static struct modbus_rtu_async async;
+        struct bench_stats decode_stats;
+        uint16_t crc_reg = CRC16_REG_INITIALIZER;
+        uint16_t i = 0u;
+
+
+        bench_clear(&decode_stats);
+
+        crc16_update(&crc_reg, modbus_resp_bytes, sizeof(modbus_resp_bytes) - 2u);
+        modbus_resp_bytes[sizeof(modbus_resp_bytes) - 2u] = (uint8_t) (crc_reg & 0xffu);
+        modbus_resp_bytes[sizeof(modbus_resp_bytes) - 1u] = (uint8_t) (crc_reg >> 8);
+
+        for (; i < BENCH_N_SAMPLES; ++i) {
+                modbus_rtu_async_init(&async);
+                async.recv = modbus_bench_recv;
+                modbus_resp_offset = 0u;
+
+                {
+                        BENCH_BEGIN();
+                        while (modbus_rtu_recv_async(NULL, &async) == MODBUS_RESULT_INCOMPLETE)
+                                ;
+                        BENCH_END(&decode_stats);
+                }
+        }
+
+        if (async.result != MODBUS_RESULT_OK || async.resp.data_size != 4u)
+                printf_P(PSTR("bench: ModBus response decoded with error\n"));
+
+        bench_report(PSTR("modbus_resp_decode"), &decode_stats);
+}
+
+static void bench_dhtxx(void)
+{
+        static uint8_t const data[DHTXX_DATA_SIZE] = { 0x02, 0x8c, 0x01, 0x5f, 0xee };
+        struct dhtxx_decoder dec;
+        struct bench_stats decode_stats;
+        uint16_t cycles = 0u;
+        uint8_t bit_num = 0u;
+        uint16_t i = 0u;
+
+
+        bench_clear(&decode_stats);
+
+        for (; i < BENCH_N_SAMPLES; ++i) {
+                dhtxx_decoder_reset(&dec);
+
+                {
+                        BENCH_BEGIN();
+
+                        /* Response pulse and 40 bits with 80us/27us/70us timings, as seen by edge ISR */
+                        cycles = 0u;
+                        dhtxx_decoder_edge(&dec, GPIO_STATE_LOW, cycles);
+                        dhtxx_decoder_edge(&dec, GPIO_STATE_HIGH, cycles += 80u * HRTIMER_CYCLES_PER_USEC);
+                        dhtxx_decoder_edge(&dec, GPIO_STATE_LOW, cycles += 80u * HRTIMER_CYCLES_PER_USEC);
+
+                        for (bit_num = 0u; bit_num < DHTXX_DATA_SIZE * 8u; ++bit_num) {
+                                dhtxx_decoder_edge(&dec, GPIO_STATE_HIGH, cycles += 50u * HRTIMER_CYCLES_PER_USEC);
+
+                                if (data[bit_num / 8u] & (0x80u >> (bit_num % 8u)))
+                                        cycles += 70u * HRTIMER_CYCLES_PER_USEC;
+                                else
+                                        cycles += 27u * HRTIMER_CYCLES_PER_USEC;
+
+                                dhtxx_decoder_edge(&dec, GPIO_STATE_LOW, cycles);
+                        }
+
+                        BENCH_END(&decode_stats);
+                }
+        }
+
+        if (!dhtxx_decoder_is_completed(&dec) || memcmp(dec.data, data, sizeof(data)) != 0)
+                printf_P(PSTR("bench: DHTxx decoder produced wrong data\n"));
+
+        bench_report(PSTR("dhtxx_decode"), &decode_stats);
+}
+
+int main(void)
+{
+        if (!uart_setup_P(&report_uart, PSTR(BENCH_UART_PARAMS))
+                        || !uart_setup_P(&isr_uart, PSTR(BENCH_ISR_UART_PARAMS))) {
+
+                return 1;
+        }
+
+        uart_bind_to_cstdout(&report_uart);
+        hrtimer_setup();
+        bench_calibrate();
+
+        sei();
+        printf_P(PSTR("bench: %lu Hz, overhead %u cycles\n"), (unsigned long) F_CPU, overhead);
+
+        bench_fifo();
+        bench_uart_isr();
+        bench_crc16();
+        bench_frame();
+        bench_modbus();
+        bench_dhtxx();
+
+        printf_P(PSTR("bench: done\n"));
+        uart_flush(&report_uart);
+
+        /* NOTE: simavr quits when CPU goes to sleep with interrupts disabled */
+        cli();
+        sleep_mode();
+
+        for (;;)
+                ;
+
+
+        return 0;
+}
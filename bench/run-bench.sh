@@ -0,0 +1,34 @@
+#!/bin/sh
+#
+# Runs benchmark firmware under simavr and prints its results as
+#
+#       <name> <n_samples> <min> <avg> <max>
+#
+# one line per benchmark, numbers are CPU cycles. Usage: run-bench.sh SIMAVR FLAGS ELF
+#
+
+set -e
+
+simavr="$1"
+flags="$2"
+elf="$3"
+
+# NOTE: Firmware puts CPU to sleep with interrupts disabled when done, that stops simavr
+output=$(timeout 300 $simavr $flags "$elf" 2>&1) || true
+
+results=$(printf '%s\n' "$output" | grep -o 'bench [a-z0-9_]* [0-9]* [0-9]* [0-9]* [0-9]*' \
+		| sed 's/^bench //')
+
+if [ -z "$results" ] || ! printf '%s\n' "$output" | grep -q 'bench: done'; then
+	printf '%s\n' "$output" >&2
+	echo "run-bench.sh: benchmark firmware did not finish" >&2
+	exit 1
+fi
+
+if printf '%s\n' "$output" | grep -q 'bench: .* error\|bench: .* wrong'; then
+	printf '%s\n' "$output" | grep 'bench: ' >&2
+	exit 1
+fi
+
+echo "# name n_samples min avg max (CPU cycles)"
+printf '%s\n' "$results"
@@ -0,0 +1,149 @@
+/*
+ * Copyright (c) 2018 Sereda Anton
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ */
+
+#ifndef BOARD_H
+#define BOARD_H
+
+#include <avr/io.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Description of the MCU the firmware is built for, selected by avr-gcc -mmcu (make mcu=...).
+ * Peripheral lists are X-macros, modules expand them into their register tables and ISRs:
+ *
+ *      BOARD_UART_LIST(X)              X(n, rx_vect, udre_vect) for every USARTn
+ *      BOARD_GPIO_PORT_LIST(X)         X(letter, port) for every I/O port
+ *      BOARD_EXTINT_LIST(X)            X(n, port, bit) for external interrupt INTn on pin
+ *      BOARD_PCINT_BANK_LIST(X)        X(bank) for every pin change interrupt bank
+ *      BOARD_PCINT_LIST(X)             X(bank, port, first_bit, first_pcint, n_pins) for
+ *                                      every run of pins with consecutive PCINT numbers
+ *
+ * NOTE: Timer/Counter0 (system clock) and Timer/Counter1 (cycle counter) have the same
+ *       registers and vectors on every supported part, so they need no tables here.
+ */
+
+#if defined(__AVR_ATmega2560__)
+
+#define BOARD_NAME "atmega2560"
+
+#define BOARD_UART_LIST(X)                                                      \
+        X(0, USART0_RX_vect, USART0_UDRE_vect)                                  \
+        X(1, USART1_RX_vect, USART1_UDRE_vect)                                  \
+        X(2, USART2_RX_vect, USART2_UDRE_vect)                                  \
+        X(3, USART3_RX_vect, USART3_UDRE_vect)
+
+#define BOARD_GPIO_PORT_LIST(X)                                                 \
+        X('A', A) X('B', B) X('C', C) X('D', D) X('E', E) X('F', F)             \
+        X('G', G) X('H', H) X('J', J) X('K', K) X('L', L)
+
+#define BOARD_EXTINT_LIST(X)                                                    \
+        X(0, D, 0) X(1, D, 1) X(2, D, 2) X(3, D, 3)                             \
+        X(4, E, 4) X(5, E, 5) X(6, E, 6) X(7, E, 7)
+
+#define BOARD_N_PCINT_BANKS 3
+
+#define BOARD_PCINT_BANK_LIST(X) X(0) X(1) X(2)
+
+/* NOTE: PE0 is PCINT8, PJ0..PJ6 are PCINT9..PCINT15 */
+#define BOARD_PCINT_LIST(X)                                                     \
+        X(0, B, 0, 0, 8)                                                        \
+        X(1, E, 0, 8, 1)                                                        \
+        X(1, J, 0, 9, 7)                                                        \
+        X(2, K, 0, 16, 8)
+
+/* Arduino Mega: LED "L" */
+#define BOARD_LED_PIN GPIO_PIN(B, 7)
+
+#define BOARD_MODBUS_RTU_PARAMS "uart=UART1:9600@8N1,de_port=PORTL:0"
+
+#elif defined(__AVR_ATmega1284P__)
+
+#define BOARD_NAME "atmega1284p"
+
+#define BOARD_UART_LIST(X)                                                      \
+        X(0, USART0_RX_vect, USART0_UDRE_vect)                                  \
+        X(1, USART1_RX_vect, USART1_UDRE_vect)
+
+#define BOARD_GPIO_PORT_LIST(X)                                                 \
+        X('A', A) X('B', B) X('C', C) X('D', D)
+
+#define BOARD_EXTINT_LIST(X)                                                    \
+        X(0, D, 2) X(1, D, 3) X(2, B, 2)
+
+#define BOARD_N_PCINT_BANKS 4
+
+#define BOARD_PCINT_BANK_LIST(X) X(0) X(1) X(2) X(3)
+
+#define BOARD_PCINT_LIST(X)                                                     \
+        X(0, A, 0, 0, 8)                                                        \
+        X(1, B, 0, 8, 8)                                                        \
+        X(2, C, 0, 16, 8)                                                       \
+        X(3, D, 0, 24, 8)
+
+#define BOARD_LED_PIN GPIO_PIN(B, 0)
+
+/* NOTE: USART1 is on PD2/PD3, DE line goes next to it */
+#define BOARD_MODBUS_RTU_PARAMS "uart=UART1:9600@8N1,de_port=PORTD:4"
+
+#elif defined(__AVR_ATmega328P__)
+
+#define BOARD_NAME "atmega328p"
+
+/* NOTE: Registers are numbered (UCSR0A), but vectors are not */
+#define BOARD_UART_LIST(X)                                                      \
+        X(0, USART_RX_vect, USART_UDRE_vect)
+
+#define BOARD_GPIO_PORT_LIST(X)                                                 \
+        X('B', B) X('C', C) X('D', D)
+
+#define BOARD_EXTINT_LIST(X)                                                    \
+        X(0, D, 2) X(1, D, 3)
+
+#define BOARD_N_PCINT_BANKS 3
+
+#define BOARD_PCINT_BANK_LIST(X) X(0) X(1) X(2)
+
+/* NOTE: PC6 is RESET pin, it is PCINT14 only if reset is disabled by fuses */
+#define BOARD_PCINT_LIST(X)                                                     \
+        X(0, B, 0, 0, 8)                                                        \
+        X(1, C, 0, 8, 7)                                                        \
+        X(2, D, 0, 16, 8)
+
+/* Arduino Uno / Nano: LED "L" */
+#define BOARD_LED_PIN GPIO_PIN(B, 5)
+
+/* NOTE: Only UART is the console, sensor nodes are ModBus slaves and have no master */
+#define BOARD_MODBUS_RTU_PARAMS ""
+
+#else
+#error "Unsupported MCU, see board.h for the list of supported ones"
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* BOARD_H */
@@ -6,11 +6,13 @@
 #include <util/atomic.h>
 
 #include "clock.h"
+#include "latency.h"
 
 /*
  * NOTE: On 16Mhz clock with prescaler 64, Timer/Counter reaches this value at 1ms interval
  */
 #define CLOCK_OCR_VALUE 249u
+#define CLOCK_PRESCALER 64u
 
 static struct clock_time sys_time = {0, };
 
@@ -33,12 +35,21 @@ void clock_setup(void)
 
 void clock_get_time(struct clock_time *ct)
 {
-        ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        LATENCY_ATOMIC_BLOCK(LATENCY_SITE_CLOCK) {
                 memcpy(ct, &sys_time, sizeof(struct clock_time));
 
         }
 }
 
+unsigned long clock_get_msecs(void)
+{
+        struct clock_time ct;
+
+
+        clock_get_time(&ct);
+        return (ct.sec * 1000ul) + ct.msec;
+}
+
 double clock_diff(struct clock_time *x, struct clock_time *y)
 {
         double x_msec = NAN;
@@ -61,7 +72,7 @@ int clock_cmp(struct clock_time *x, struct clock_time *y)
 
         if (x->msec > y->msec)
                 return -1;
-        else if (y->msec < y->msec)
+        else if (x->msec < y->msec)
                 return 1;
 
 
@@ -70,10 +81,17 @@ int clock_cmp(struct clock_time *x, struct clock_time *y)
 
 ISR(TIMER0_COMPA_vect)
 {
+        LATENCY_ISR_BEGIN(LATENCY_SITE_CLOCK_ISR);
+
+        /* NOTE: Counter keeps running after compare match, so its value shows how late we are */
+        LATENCY_TICK(TCNT0 - OCR0A, CLOCK_PRESCALER);
+
         if (sys_time.msec == 999ul) {
                 sys_time.msec = 0ul;
                 sys_time.sec++;
 
         } else
                 sys_time.msec++;
+
+        LATENCY_ISR_END(LATENCY_SITE_CLOCK_ISR);
 }
@@ -55,6 +55,7 @@ struct clock_time {
 
 void clock_setup(void);
 void clock_get_time(struct clock_time *ct);
+unsigned long clock_get_msecs(void);
 double clock_diff(struct clock_time *x, struct clock_time *y);
 int clock_cmp(struct clock_time *x, struct clock_time *y);
 
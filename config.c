@@ -0,0 +1,84 @@
+#include <stddef.h>
+#include <string.h>
+#include <avr/eeprom.h>
+#include <avr/pgmspace.h>
+
+#include "config.h"
+#include "crc16.h"
+
+#define CONFIG_CRC_SIZE offsetof(struct config, crc)
+
+/* NOTE: Erased or foreign EEPROM content fails version and CRC checks */
+static struct config eeprom_config EEMEM;
+
+static struct config config;
+static enum config_source config_source = CONFIG_SOURCE_DEFAULTS;
+static bool is_loaded = false;
+
+static uint16_t calc_crc(const struct config *cfg)
+{
+        uint16_t crc_reg = CRC16_REG_INITIALIZER;
+
+
+        crc16_update(&crc_reg, cfg, CONFIG_CRC_SIZE);
+
+
+        return crc_reg;
+}
+
+void config_load_defaults(struct config *cfg)
+{
+        /* NOTE: Section that fails to parse stays zeroed and its setup fails later */
+        memset(cfg, 0, sizeof(struct config));
+
+        cfg->version = CONFIG_VERSION;
+        cfg->size = (uint8_t) sizeof(struct config);
+
+        uart_parse_params_P(&cfg->console, PSTR(UART_DEV_PARAMS));
+        modbus_rtu_parse_params_P(&cfg->modbus, PSTR(MODBUS_RTU_PARAMS));
+        gpio_parse_params_P(&cfg->dht_port, PSTR(DHTXX_PORT_PARAMS));
+}
+
+bool config_load(struct config *cfg)
+{
+        eeprom_read_block(cfg, &eeprom_config, sizeof(struct config));
+
+
+        return cfg->version == CONFIG_VERSION && cfg->size == (uint8_t) sizeof(struct config)
+                && cfg->crc == calc_crc(cfg);
+}
+
+void config_save(struct config *cfg)
+{
+        cfg->version = CONFIG_VERSION;
+        cfg->size = (uint8_t) sizeof(struct config);
+        cfg->crc = calc_crc(cfg);
+
+        /* NOTE: Only changed bytes are written, EEPROM cells have limited endurance */
+        eeprom_update_block(cfg, &eeprom_config, sizeof(struct config));
+}
+
+struct config *config_get(void)
+{
+        if (!is_loaded) {
+                if (config_load(&config)) {
+                        config_source = CONFIG_SOURCE_EEPROM;
+                } else {
+                        config_load_defaults(&config);
+                        config_source = CONFIG_SOURCE_DEFAULTS;
+                }
+
+                is_loaded = true;
+        }
+
+
+        return &config;
+}
+
+enum config_source config_get_source(void)
+{
+        config_get();
+
+
+        return config_source;
+}
@@ -0,0 +1,81 @@
+/*
+ * Copyright (c) 2018 Sereda Anton
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ */
+
+#ifndef CONFIG_H
+#define CONFIG_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "uart.h"
+#include "gpio.h"
+#include "modbus-rtu.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifndef UART_DEV_PARAMS
+#define UART_DEV_PARAMS        "UART0:115200@8N1"
+#endif
+
+#ifndef DHTXX_PORT_PARAMS
+#define DHTXX_PORT_PARAMS      "PORTB:4"
+#endif
+
+/*
+ * NOTE: Settings are kept in EEPROM in pre-parsed form, so boot does not run sscanf() and
+ *       strtok_r() over parameter strings. Block is accepted only if its version, size
+ *       and CRC16 match, otherwise compiled-in parameter strings above are parsed.
+ *       Bump CONFIG_VERSION on any change of struct config layout.
+ */
+
+#define CONFIG_VERSION 1
+
+enum config_source {
+        CONFIG_SOURCE_DEFAULTS = 0,
+        CONFIG_SOURCE_EEPROM
+};
+
+struct config {
+        uint8_t version;
+        uint8_t size;
+
+        struct uart_params console;
+        struct modbus_rtu_params modbus;
+        struct gpio_params dht_port;
+
+        uint16_t crc;
+};
+
+void config_load_defaults(struct config *cfg);
+bool config_load(struct config *cfg);
+void config_save(struct config *cfg);
+struct config *config_get(void);
+enum config_source config_get_source(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* CONFIG_H */
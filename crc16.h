@@ -0,0 +1,84 @@
+/*
+ * Copyright (c) 2018 Sereda Anton
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ */
+
+#ifndef CRC16_H
+#define CRC16_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "profile.h"
+#include "mem-chunk.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Initial value of CRC16 register from MODBUS RTU standart */
+#define CRC16_REG_INITIALIZER 0xffffu
+
+static inline void crc16_byte(uint16_t *crc_reg, uint8_t byte)
+{
+        size_t i = 0u;
+
+
+        PROFILE_BEGIN(PROFILE_REGION_CRC16_BYTE);
+
+        *crc_reg ^= byte;
+
+        for (; i < 8u; ++i) {
+                if ((*crc_reg & 1u) != 0u) {
+                        *crc_reg >>= 1;
+                        *crc_reg ^= 0xa001u;
+                } else
+                        *crc_reg >>= 1;
+        }
+
+        PROFILE_END(PROFILE_REGION_CRC16_BYTE);
+}
+
+static inline void crc16_update(uint16_t *crc_reg, const void *data, size_t size)
+{
+        const uint8_t *bytes = NULL;
+        size_t i = 0u;
+
+
+        bytes = (const uint8_t *) data;
+        for (; i < size; ++i)
+                crc16_byte(crc_reg, bytes[i]);
+}
+
+static inline void crc16_update_chain(uint16_t *crc_reg, const struct mem_chain *chain)
+{
+        const struct mem_chunk *chunk = NULL;
+
+
+        MEM_CHAIN_FOREACH(chain, chunk)
+                crc16_update(crc_reg, chunk->ptr, chunk->size);
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* CRC16_H */
@@ -1,18 +1,113 @@
-#include <stdio.h>
 #include <string.h>
 #include <stdbool.h>
-#include <math.h>
 #include <util/delay.h>
 #include <util/atomic.h>
 #include <avr/pgmspace.h>
 
 #include "dhtxx.h"
+#include "latency.h"
+#include "hrtimer.h"
+
+enum {
+        DECODER_WAIT_START,
+        DECODER_WAIT_RISE,
+        DECODER_WAIT_FALL,
+        DECODER_COMPLETED
+};
+
+/* Response pulse, then 40 data bits */
+#define DECODER_N_PULSES (1u + DHTXX_DATA_SIZE * 8u)
+
+/* NOTE: High level lasts 26-28us for "0" and 70us for "1" */
+#define DECODER_BIT_THRESHOLD_CYCLES ((uint16_t) (48u * HRTIMER_CYCLES_PER_USEC))
+
+enum {
+        ASYNC_POLL_INIT,
+        ASYNC_POLL_START_PULSE,
+        ASYNC_POLL_RESPONSE,
+        ASYNC_POLL_COMPLETED
+};
+
+/*
+ * NOTE: DHT22 needs 0.8..20ms start pulse and DHT11 needs at least 18ms.
+ *       Timer has 1ms resolution, so real start pulse is up to 1ms longer.
+ */
+#define START_PULSE_MSECS 1ul
+#define DHT11_START_PULSE_MSECS 20ul
+#define RESPONSE_TIMEOUT_MSECS 10ul
+
+#define BANK_START_PULSE_USECS 1000u
+#define BANK_DHT11_START_PULSE_USECS 20000u
+#define BANK_RESPONSE_TIMEOUT_CYCLES ((uint32_t) RESPONSE_TIMEOUT_MSECS * 1000ul * HRTIMER_CYCLES_PER_USEC)
+
+void dhtxx_decoder_reset(struct dhtxx_decoder *dec)
+{
+        memset(dec, 0, sizeof(struct dhtxx_decoder));
+
+        dec->state = DECODER_WAIT_START;
+}
+
+bool dhtxx_decoder_edge(struct dhtxx_decoder *dec, enum gpio_state state, uint16_t cycles)
+{
+        uint8_t bit_num = 0u;
+
+
+        if (dec->state == DECODER_WAIT_START) {
+                /* Sensor starts response by pulling bus low, all earlier edges are ours */
+                if (state == GPIO_STATE_LOW)
+                        dec->state = DECODER_WAIT_RISE;
+
+        } else if (dec->state == DECODER_WAIT_RISE) {
+                if (state == GPIO_STATE_HIGH) {
+                        dec->rise_cycles = cycles;
+                        dec->state = DECODER_WAIT_FALL;
+                }
+
+        } else if (dec->state == DECODER_WAIT_FALL) {
+                if (state == GPIO_STATE_LOW) {
+                        /* NOTE: First high pulse is the response, it carries no data */
+                        if (dec->n_pulses > 0u) {
+                                bit_num = (uint8_t) (dec->n_pulses - 1u);
+
+                                if ((uint16_t) (cycles - dec->rise_cycles) > DECODER_BIT_THRESHOLD_CYCLES)
+                                        dec->data[bit_num / 8u] |= (uint8_t) (0x80u >> (bit_num % 8u));
+                        }
+
+                        dec->n_pulses++;
+                        dec->state = (dec->n_pulses < DECODER_N_PULSES) ? DECODER_WAIT_RISE
+                                                                         : DECODER_COMPLETED;
+                }
+        }
+
+
+        return dec->state == DECODER_COMPLETED;
+}
+
+bool dhtxx_decoder_is_completed(struct dhtxx_decoder *dec)
+{
+        return dec->state == DECODER_COMPLETED;
+}
+
+static void decoder_intr_handler(struct gpio_intr *intr, enum gpio_state state, uint16_t cycles)
+{
+        struct dhtxx *dht = NULL;
+
+
+        dht = (struct dhtxx *) intr->arg;
+        dhtxx_decoder_edge(&dht->decoder, state, cycles);
+}
 
 void dhtxx_init(struct dhtxx *dht, struct gpio *dht_port)
 {
         memset(dht, 0, sizeof(struct dhtxx));
 
         dht->port = dht_port;
+        gpio_intr_init(&dht->intr, decoder_intr_handler, dht);
+}
+
+void dhtxx_set_type(struct dhtxx *dht, enum dhtxx_type type)
+{
+        dht->type = type;
 }
 
 static inline void usleep(unsigned long usecs)
@@ -26,12 +121,30 @@ static inline void sda_high(struct dhtxx *dht)
          * NOTE: We use external pullup resistor, so when we change
          *       port direction to input, bus automatically pulled up to VCC...
          */
+#ifdef DHTXX_PIN
+        GPIO_PIN_INPUT(DHTXX_PIN);
+#else
         gpio_set_direction(dht->port, GPIO_DIRECTION_INPUT);
+#endif
 }
 
 static inline void sda_low(struct dhtxx *dht)
 {
+#ifdef DHTXX_PIN
+        GPIO_PIN_LOW(DHTXX_PIN);
+        GPIO_PIN_OUTPUT(DHTXX_PIN);
+#else
         gpio_write(dht->port, GPIO_STATE_LOW);
+#endif
+}
+
+static inline enum gpio_state sda_state(struct dhtxx *dht)
+{
+#ifdef DHTXX_PIN
+        return GPIO_PIN_READ(DHTXX_PIN);
+#else
+        return gpio_read(dht->port);
+#endif
 }
 
 static inline bool sda_expect(struct dhtxx *dht, enum gpio_state state,
@@ -40,10 +153,10 @@ static inline bool sda_expect(struct dhtxx *dht, enum gpio_state state,
         unsigned long tick_count = 0u;
 
 
-        if (gpio_read(dht->port) != state)
+        if (sda_state(dht) != state)
                 return false;
 
-        while (gpio_read(dht->port) == state) {
+        while (sda_state(dht) == state) {
                 usleep(1u);
                 if (tick_count++ >= max_ticks)
                         return false;
@@ -59,7 +172,7 @@ static inline bool sda_read(struct dhtxx *dht, int *result)
 
         if (sda_expect(dht, GPIO_STATE_LOW, 50u)) {
                 usleep(26u);
-                if (gpio_read(dht->port) == GPIO_STATE_LOW)
+                if (sda_state(dht) == GPIO_STATE_LOW)
                         return true;
 
                 *result = 1;
@@ -82,21 +195,44 @@ static inline bool data_checksum(uint8_t *data)
         return false;
 }
 
+static inline enum dhtxx_result store_data(struct dhtxx *dht, uint8_t *data)
+{
+        if (!data_checksum(data))
+                return DHTXX_RESULT_BAD_CHECKSUM;
+
+        if (dht->type == DHTXX_TYPE_DHT11) {
+                /* Integral and decimal parts in separate bytes, sign in MSB of decimal byte */
+                dht->humidity_x10 = (int16_t) (data[0] * 10 + data[1]);
+                dht->temperature_x10 = (int16_t) (data[2] * 10 + (data[3] & 0x7fu));
+
+                if ((data[3] & 0x80u) != 0u)
+                        dht->temperature_x10 = (int16_t) -dht->temperature_x10;
+
+        } else {
+                /* NOTE: Temperature is sign-magnitude, not two's complement */
+                dht->humidity_x10 = (int16_t) ((data[0] << 8) | data[1]);
+                dht->temperature_x10 = (int16_t) (((data[2] & 0x7fu) << 8) | data[3]);
+
+                if ((data[2] & 0x80u) != 0u)
+                        dht->temperature_x10 = (int16_t) -dht->temperature_x10;
+        }
+
+
+        return DHTXX_RESULT_SUCCESS;
+}
+
 static inline enum dhtxx_result sda_read_data(struct dhtxx *dht)
 {
-        enum dhtxx_result result = DHTXX_RESULT_SUCCESS;
         int i = 0;
         int byte = 0;
-        uint8_t data[5] = {0, };
+        uint8_t data[DHTXX_DATA_SIZE] = {0, };
         int shift = 8;
         int bit_value = 0;
 
 
         for (; i < 40; ++i) {
-                if (!sda_read(dht, &bit_value)) {
-                        result = DHTXX_RESULT_NO_RESPONSE;
-                        break;
-                }
+                if (!sda_read(dht, &bit_value))
+                        return DHTXX_RESULT_NO_RESPONSE;
 
                 if (shift == 0) {
                         shift = 8;
@@ -106,20 +242,21 @@ static inline enum dhtxx_result sda_read_data(struct dhtxx *dht)
                 data[byte] |= (bit_value << --shift);
         }
 
-        if (data_checksum(data)) {
-                dht->raw_humidity = (data[0] << 8) | data[1];
-                dht->raw_temperature = (data[2] << 8) | data[3];
-        } else
-                result = DHTXX_RESULT_BAD_CHECKSUM;
 
+        return store_data(dht, data);
+}
 
-        return result;
+static inline void sda_start_pulse(struct dhtxx *dht)
+{
+        sda_low(dht);
+        if (dht->type == DHTXX_TYPE_DHT11)
+                usleep(20000u);
+        else
+                usleep(800u);
 }
 
 static inline bool sda_begin_poll(struct dhtxx *dht)
 {
-        sda_low(dht);
-        usleep(800u);
         sda_high(dht);
 
         if (sda_expect(dht, GPIO_STATE_HIGH, 20u)) {
@@ -132,13 +269,16 @@ static inline bool sda_begin_poll(struct dhtxx *dht)
         return false;
 }
 
-enum dhtxx_result dhtxx_poll(struct dhtxx *dht)
+static enum dhtxx_result bitbang_poll(struct dhtxx *dht)
 {
         enum dhtxx_result result = DHTXX_RESULT_NO_RESPONSE;
 
 
+        /* NOTE: Bus is held low with interrupts enabled, only release and response are timed */
+        sda_start_pulse(dht);
+
 #ifdef DHTXX_STRICT_TIMINGS
-        ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        LATENCY_ATOMIC_BLOCK(LATENCY_SITE_DHTXX_POLL) {
 #endif
                 if (sda_begin_poll(dht))
                         result = sda_read_data(dht);
@@ -151,20 +291,288 @@ enum dhtxx_result dhtxx_poll(struct dhtxx *dht)
         return result;
 }
 
+void dhtxx_async_init(struct dhtxx_async *async)
+{
+        memset(async, 0, sizeof(struct dhtxx_async));
+
+        async->state = ASYNC_POLL_INIT;
+        async->result = DHTXX_RESULT_INCOMPLETE;
+}
+
+bool dhtxx_async_is_completed(struct dhtxx_async *async)
+{
+        return async->state == ASYNC_POLL_COMPLETED;
+}
+
+static inline enum dhtxx_result async_poll_complete(struct dhtxx_async *async,
+                                                    enum dhtxx_result result)
+{
+        async->state = ASYNC_POLL_COMPLETED;
+        async->result = result;
+
+        return async->result;
+}
+
+static inline enum dhtxx_result async_poll_start(struct dhtxx *dht, struct dhtxx_async *async)
+{
+        /* No interrupt on this pin: the only way left is a blocking bit-bang read */
+        if (dht->port == NULL || !gpio_intr_has_source(dht->port))
+                return async_poll_complete(async, bitbang_poll(dht));
+
+        dhtxx_decoder_reset(&dht->decoder);
+
+        sda_low(dht);
+        timer_set_msecs(&async->timer, (dht->type == DHTXX_TYPE_DHT11) ? DHT11_START_PULSE_MSECS
+                                                                        : START_PULSE_MSECS);
+
+        async->state = ASYNC_POLL_START_PULSE;
+        return async->result;
+}
+
+static inline enum dhtxx_result async_poll_release(struct dhtxx *dht, struct dhtxx_async *async)
+{
+        if (!timer_expired(&async->timer))
+                return async->result;
+
+        /*
+         * NOTE: Attaching switches pin to input, so this releases the bus and
+         *       the sensor response is captured from the very first edge
+         */
+        if (!gpio_intr_attach(&dht->intr, dht->port, GPIO_EDGE_ANY, 0u)) {
+                /* NOTE: Source is taken by other line, start pulse is not repeated */
+                sda_high(dht);
+                return async_poll_complete(async, DHTXX_RESULT_NO_RESPONSE);
+        }
+
+        sda_high(dht);
+        timer_set_msecs(&async->timer, RESPONSE_TIMEOUT_MSECS);
+
+        async->state = ASYNC_POLL_RESPONSE;
+        return async->result;
+}
+
+static inline enum dhtxx_result async_poll_response(struct dhtxx *dht, struct dhtxx_async *async)
+{
+        if (dhtxx_decoder_is_completed(&dht->decoder)) {
+                gpio_intr_detach(&dht->intr);
+                return async_poll_complete(async, store_data(dht, dht->decoder.data));
+        }
+
+        if (timer_expired(&async->timer)) {
+                gpio_intr_detach(&dht->intr);
+                return async_poll_complete(async, DHTXX_RESULT_NO_RESPONSE);
+        }
+
+
+        return async->result;
+}
+
+enum dhtxx_result dhtxx_poll_async(struct dhtxx *dht, struct dhtxx_async *async)
+{
+        if (async->state == ASYNC_POLL_INIT)
+                return async_poll_start(dht, async);
+        else if (async->state == ASYNC_POLL_START_PULSE)
+                return async_poll_release(dht, async);
+        else if (async->state == ASYNC_POLL_RESPONSE)
+                return async_poll_response(dht, async);
+
+
+        return async->result;
+}
+
+enum dhtxx_result dhtxx_poll(struct dhtxx *dht)
+{
+        struct dhtxx_async async;
+
+
+        dhtxx_async_init(&async);
+
+        /* Interrupts stay enabled, decoding is done from pin change ISR */
+        while (!dhtxx_async_is_completed(&async))
+                dhtxx_poll_async(dht, &async);
+
+
+        return async.result;
+}
+
+void dhtxx_bank_init(struct dhtxx_bank *bank)
+{
+        size_t i = 0u;
+
+
+        memset(bank, 0, sizeof(struct dhtxx_bank));
+        hrtimer_setup();
+
+        for (; i < DHTXX_BANK_MAX_SENSORS; ++i)
+                bank->results[i] = DHTXX_RESULT_NO_RESPONSE;
+}
+
+bool dhtxx_bank_add(struct dhtxx_bank *bank, struct dhtxx *dht)
+{
+        struct gpio *port = NULL;
+
+
+        port = dht->port;
+        if (port == NULL || !gpio_is_usable(port))
+                return false;
+
+        if (bank->group.mask != 0u && bank->group.port_letter != port->port_letter)
+                return false;   /* All sensors must share one port */
+
+        if (bank->sensors[port->bit] != NULL)
+                return false;
+
+        bank->group.port_letter = port->port_letter;
+        bank->group.mask |= (uint8_t) _BV(port->bit);
+        bank->sensors[port->bit] = dht;
+
+
+        return true;
+}
+
+static void bank_sample(struct dhtxx_bank *bank)
+{
+        uint8_t last = 0u;
+        uint8_t sample = 0u;
+        uint8_t changed = 0u;
+        uint8_t pending = 0u;
+        uint16_t now = 0u;
+        uint16_t prev = 0u;
+        uint32_t elapsed = 0ul;
+        size_t i = 0u;
+
+
+        pending = bank->group.mask;
+        last = gpio_group_read(&bank->group);
+        prev = hrtimer_now();
+
+        while (pending != 0u && elapsed < BANK_RESPONSE_TIMEOUT_CYCLES) {
+                /* NOTE: Keep sample and its timestamp together, ISRs may run only between slices */
+                ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+                        sample = gpio_group_read(&bank->group);
+                        now = hrtimer_now();
+                }
+
+                elapsed += (uint16_t) (now - prev);
+                prev = now;
+
+                changed = (uint8_t) ((sample ^ last) & pending);
+                last = sample;
+
+                for (i = 0u; changed != 0u; ++i, changed >>= 1) {
+                        if ((changed & 1u) == 0u)
+                                continue;
+
+                        if (dhtxx_decoder_edge(&bank->sensors[i]->decoder,
+                                               ((sample & _BV(i)) != 0u) ? GPIO_STATE_HIGH : GPIO_STATE_LOW,
+                                               now)) {
+                                pending &= (uint8_t) ~(_BV(i));
+                        }
+                }
+        }
+}
+
+enum dhtxx_result dhtxx_bank_poll(struct dhtxx_bank *bank)
+{
+        enum dhtxx_result result = DHTXX_RESULT_SUCCESS;
+        struct dhtxx *dht = NULL;
+        size_t i = 0u;
+        bool has_dht11 = false;
+
+
+        if (bank->group.mask == 0u)
+                return DHTXX_RESULT_NO_RESPONSE;
+
+        for (; i < DHTXX_BANK_MAX_SENSORS; ++i) {
+                if (bank->sensors[i] != NULL) {
+                        dhtxx_decoder_reset(&bank->sensors[i]->decoder);
+
+                        if (bank->sensors[i]->type == DHTXX_TYPE_DHT11)
+                                has_dht11 = true;
+                }
+        }
+
+        /* Start all sensors at once, then release the bus and sample whole port */
+        gpio_group_write(&bank->group, 0u);
+        gpio_group_set_direction(&bank->group, GPIO_DIRECTION_OUTPUT);
+        if (has_dht11)
+                usleep(BANK_DHT11_START_PULSE_USECS);
+        else
+                usleep(BANK_START_PULSE_USECS);
+        gpio_group_set_direction(&bank->group, GPIO_DIRECTION_INPUT);
+
+        bank_sample(bank);
+
+        for (i = 0u; i < DHTXX_BANK_MAX_SENSORS; ++i) {
+                dht = bank->sensors[i];
+                if (dht == NULL)
+                        continue;
+
+                if (dhtxx_decoder_is_completed(&dht->decoder))
+                        bank->results[i] = store_data(dht, dht->decoder.data);
+                else
+                        bank->results[i] = DHTXX_RESULT_NO_RESPONSE;
+
+                if (result == DHTXX_RESULT_SUCCESS)
+                        result = bank->results[i];
+        }
+
+
+        return result;
+}
+
+enum dhtxx_result dhtxx_bank_get_result(struct dhtxx_bank *bank, struct dhtxx *dht)
+{
+        if (dht->port == NULL || bank->sensors[dht->port->bit] != dht)
+                return DHTXX_RESULT_NO_RESPONSE;
+
+
+        return bank->results[dht->port->bit];
+}
+
+int16_t dhtxx_get_temperature_x10(struct dhtxx *dht)
+{
+        return dht->temperature_x10;
+}
+
+int16_t dhtxx_get_humidity_x10(struct dhtxx *dht)
+{
+        return dht->humidity_x10;
+}
+
 double dhtxx_get_temperature(struct dhtxx *dht)
 {
-        return ((double) dht->raw_temperature) / 10.0;
+        return ((double) dht->temperature_x10) / 10.0;
 }
 
 double dhtxx_get_humidity(struct dhtxx *dht)
 {
-        return ((double) dht->raw_humidity) / 10.0;
+        return ((double) dht->humidity_x10) / 10.0;
+}
+
+void dhtxx_data_json_write(struct dhtxx *dht, struct json_writer *w)
+{
+        json_writer_begin_object(w);
+
+        json_writer_key_P(w, PSTR("temperature"));
+        json_writer_fixed(w, dht->temperature_x10, 1u);
+        json_writer_key_P(w, PSTR("humidity"));
+        json_writer_fixed(w, dht->humidity_x10, 1u);
+
+        json_writer_end_object(w);
 }
 
 bool dhtxx_data_json_stringify(struct dhtxx *dht, char *buf, size_t buf_size)
 {
-        return ((size_t) snprintf_P(buf, buf_size,
-                                    PSTR("{\"temperature\":%f,\"humidity\":%f}"),
-                                    dhtxx_get_temperature(dht),
-                                    dhtxx_get_humidity(dht))) <= buf_size;
+        struct mem_chunk chunk;
+        struct json_writer w;
+
+
+        mem_chunk_set(&chunk, buf, buf_size);
+        json_writer_init_chunk(&w, &chunk);
+
+        dhtxx_data_json_write(dht, &w);
+
+
+        return json_writer_finish(&w);
 }
@@ -28,30 +28,95 @@
 #include <stdint.h>
 
 #include "gpio.h"
+#include "gpio-intr.h"
+#include "timer.h"
+#include "json-writer.h"
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
+/*
+ * NOTE: Sensor is decoded in background from pin change timestamps when its pin has
+ *       an external or pin change interrupt. Otherwise we fall back to bit-banging,
+ *       which runs with interrupts disabled when DHTXX_STRICT_TIMINGS is set.
+ */
 #define DHTXX_STRICT_TIMINGS 1
 
+#define DHTXX_DATA_SIZE 5
+
+/*
+ * NOTE: For a single sensor build define DHTXX_PIN as GPIO_PIN(x, n): bus is then
+ *       driven directly through I/O registers and "port" of struct dhtxx is not used.
+ */
+
 enum dhtxx_result {
         DHTXX_RESULT_SUCCESS = 0,
         DHTXX_RESULT_NO_RESPONSE,
-        DHTXX_RESULT_BAD_CHECKSUM
+        DHTXX_RESULT_BAD_CHECKSUM,
+        DHTXX_RESULT_INCOMPLETE
+};
+
+enum dhtxx_type {
+        DHTXX_TYPE_DHT22 = 0,   /* Also AM2302 and DHT21 */
+        DHTXX_TYPE_DHT11
+};
+
+struct dhtxx_decoder {
+        uint8_t data[DHTXX_DATA_SIZE];
+
+        volatile uint8_t state;
+        uint8_t n_pulses;
+        uint16_t rise_cycles;
 };
 
 struct dhtxx {
         struct gpio *port;
+        struct gpio_intr intr;
+        struct dhtxx_decoder decoder;
+
+        enum dhtxx_type type;
+
+        /* Fixed-point values in tenths of degree Celsius and tenths of percent */
+        int16_t temperature_x10;
+        int16_t humidity_x10;
+};
+
+#define DHTXX_BANK_MAX_SENSORS 8
+
+/* Sensors sitting on pins of the same port, read together */
+struct dhtxx_bank {
+        struct gpio_group group;
+
+        struct dhtxx *sensors[DHTXX_BANK_MAX_SENSORS];
+        enum dhtxx_result results[DHTXX_BANK_MAX_SENSORS];
+};
+
+struct dhtxx_async {
+        int state;
 
-        int16_t raw_temperature;
-        int16_t raw_humidity;
+        struct timer timer;
+        enum dhtxx_result result;
 };
 
+void dhtxx_decoder_reset(struct dhtxx_decoder *dec);
+bool dhtxx_decoder_edge(struct dhtxx_decoder *dec, enum gpio_state state, uint16_t cycles);
+bool dhtxx_decoder_is_completed(struct dhtxx_decoder *dec);
 void dhtxx_init(struct dhtxx *dht, struct gpio *dht_port);
+void dhtxx_set_type(struct dhtxx *dht, enum dhtxx_type type);
+void dhtxx_async_init(struct dhtxx_async *async);
+bool dhtxx_async_is_completed(struct dhtxx_async *async);
 enum dhtxx_result dhtxx_poll(struct dhtxx *dht);
+enum dhtxx_result dhtxx_poll_async(struct dhtxx *dht, struct dhtxx_async *async);
+void dhtxx_bank_init(struct dhtxx_bank *bank);
+bool dhtxx_bank_add(struct dhtxx_bank *bank, struct dhtxx *dht);
+enum dhtxx_result dhtxx_bank_poll(struct dhtxx_bank *bank);
+enum dhtxx_result dhtxx_bank_get_result(struct dhtxx_bank *bank, struct dhtxx *dht);
+int16_t dhtxx_get_temperature_x10(struct dhtxx *dht);
+int16_t dhtxx_get_humidity_x10(struct dhtxx *dht);
 double dhtxx_get_temperature(struct dhtxx *dht);
 double dhtxx_get_humidity(struct dhtxx *dht);
+void dhtxx_data_json_write(struct dhtxx *dht, struct json_writer *w);
 bool dhtxx_data_json_stringify(struct dhtxx *dht, char *buf, size_t buf_size);
 
 #ifdef __cplusplus
@@ -2,6 +2,8 @@
 #include <util/atomic.h>
 
 #include "fifo-buffer.h"
+#include "profile.h"
+#include "latency.h"
 
 void fifo_buffer_init(struct fifo_buffer *fifo, uint8_t *ptr, size_t size)
 {
@@ -16,7 +18,9 @@ bool fifo_buffer_put_byte(struct fifo_buffer *fifo, uint8_t byte)
         bool retval = false;
 
 
-        ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        PROFILE_BEGIN(PROFILE_REGION_FIFO_PUT_BYTE);
+
+        LATENCY_ATOMIC_BLOCK(LATENCY_SITE_FIFO_BUFFER) {
                 if (fifo->size < fifo->mem_size) {
                         fifo->mem[fifo->put_offset] = byte;
 
@@ -27,6 +31,8 @@ bool fifo_buffer_put_byte(struct fifo_buffer *fifo, uint8_t byte)
                 }
         }
 
+        PROFILE_END(PROFILE_REGION_FIFO_PUT_BYTE);
+
 
         return retval;
 }
@@ -36,7 +42,9 @@ bool fifo_buffer_get_byte(struct fifo_buffer *fifo, uint8_t *store)
         bool retval = false;
 
 
-        ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        PROFILE_BEGIN(PROFILE_REGION_FIFO_GET_BYTE);
+
+        LATENCY_ATOMIC_BLOCK(LATENCY_SITE_FIFO_BUFFER) {
                 if (fifo->size > 0u) {
                         *store = fifo->mem[fifo->get_offset];
 
@@ -47,6 +55,8 @@ bool fifo_buffer_get_byte(struct fifo_buffer *fifo, uint8_t *store)
                 }
         }
 
+        PROFILE_END(PROFILE_REGION_FIFO_GET_BYTE);
+
 
         return retval;
 }
@@ -56,7 +66,7 @@ size_t fifo_buffer_get_size(struct fifo_buffer *fifo)
         size_t size = 0u;
 
 
-        ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        LATENCY_ATOMIC_BLOCK(LATENCY_SITE_FIFO_BUFFER) {
                 size = fifo->size;
         }
 
@@ -0,0 +1,250 @@
+#include <string.h>
+
+#include "frame.h"
+#include "crc16.h"
+
+struct cobs_encoder {
+        uint8_t *out;
+        size_t out_size;
+        size_t out_len;
+
+        size_t code_pos;
+        uint8_t code;
+};
+
+static inline bool cobs_begin(struct cobs_encoder *cobs, uint8_t *out, size_t out_size)
+{
+        if (out_size == 0u)
+                return false;
+
+        cobs->out = out;
+        cobs->out_size = out_size;
+        cobs->out_len = 1u;
+        cobs->code_pos = 0u;
+        cobs->code = 1u;
+
+
+        return true;
+}
+
+static inline bool cobs_close_block(struct cobs_encoder *cobs)
+{
+        cobs->out[cobs->code_pos] = cobs->code;
+
+        if (cobs->out_len >= cobs->out_size)
+                return false;
+
+        cobs->code_pos = cobs->out_len++;
+        cobs->code = 1u;
+
+
+        return true;
+}
+
+static bool cobs_put(struct cobs_encoder *cobs, uint8_t byte)
+{
+        if (byte == 0u)
+                return cobs_close_block(cobs);
+
+        if (cobs->out_len >= cobs->out_size)
+                return false;
+
+        cobs->out[cobs->out_len++] = byte;
+        cobs->code++;
+
+        /* NOTE: Block of 254 non-zero bytes ends without implicit zero */
+        if (cobs->code == 0xffu)
+                return cobs_close_block(cobs);
+
+
+        return true;
+}
+
+static inline bool cobs_put_bytes(struct cobs_encoder *cobs, const uint8_t *bytes, size_t size)
+{
+        size_t i = 0u;
+
+
+        for (; i < size; ++i) {
+                if (!cobs_put(cobs, bytes[i]))
+                        return false;
+        }
+
+
+        return true;
+}
+
+static inline bool cobs_end(struct cobs_encoder *cobs)
+{
+        cobs->out[cobs->code_pos] = cobs->code;
+
+        if (cobs->out_len >= cobs->out_size)
+                return false;
+
+        cobs->out[cobs->out_len++] = FRAME_DELIMITER;
+
+
+        return true;
+}
+
+void frame_encoder_init(struct frame_encoder *enc)
+{
+        memset(enc, 0, sizeof(struct frame_encoder));
+}
+
+bool frame_encode_chain(struct frame_encoder *enc, uint8_t type,
+                        const struct mem_chain *payload, struct mem_chunk *out)
+{
+        struct cobs_encoder cobs;
+        const struct mem_chunk *chunk = NULL;
+        uint8_t header[FRAME_HEADER_SIZE];
+        uint8_t crc[FRAME_CRC_SIZE];
+        uint16_t crc_reg = CRC16_REG_INITIALIZER;
+
+
+        /*
+         * NOTE: "out" describes free buffer space on input. On success it is
+         *       set to the encoded frame, ready for uart_write_chunk()
+         */
+        if (mem_chain_get_size(payload) > FRAME_MAX_PAYLOAD_SIZE)
+                return false;
+
+        header[0] = type;
+        header[1] = enc->seq;
+
+        crc16_update(&crc_reg, header, sizeof(header));
+        crc16_update_chain(&crc_reg, payload);
+
+        crc[0] = (uint8_t) (crc_reg & 0xffu);
+        crc[1] = (uint8_t) (crc_reg >> 8);
+
+        if (!cobs_begin(&cobs, (uint8_t *) out->ptr, out->size)
+                        || !cobs_put_bytes(&cobs, header, sizeof(header)))
+                return false;
+
+        MEM_CHAIN_FOREACH(payload, chunk) {
+                if (!cobs_put_bytes(&cobs, (const uint8_t *) chunk->ptr, chunk->size))
+                        return false;
+        }
+
+        if (!cobs_put_bytes(&cobs, crc, sizeof(crc)) || !cobs_end(&cobs))
+                return false;
+
+        mem_chunk_set(out, out->ptr, cobs.out_len);
+        enc->seq++;
+
+
+        return true;
+}
+
+bool frame_encode(struct frame_encoder *enc, uint8_t type,
+                  const void *payload, size_t payload_size, struct mem_chunk *out)
+{
+        struct mem_chunk chunk;
+        struct mem_chain chain;
+
+
+        if (payload == NULL && payload_size != 0u)
+                return false;
+
+        mem_chunk_set(&chunk, (void *) payload, payload_size);
+        mem_chain_init(&chain, &chunk, 1u);
+
+
+        return frame_encode_chain(enc, type, &chain, out);
+}
+
+static inline void decoder_restart(struct frame_decoder *dec)
+{
+        dec->size = 0u;
+        dec->code = 0u;
+        dec->block_left = 0u;
+        dec->overflow = false;
+}
+
+void frame_decoder_init(struct frame_decoder *dec)
+{
+        memset(dec, 0, sizeof(struct frame_decoder));
+}
+
+static inline void decoder_append(struct frame_decoder *dec, uint8_t byte)
+{
+        if (dec->size >= FRAME_MAX_RAW_SIZE) {
+                dec->overflow = true;
+                return;
+        }
+
+        dec->buf[dec->size++] = byte;
+}
+
+static enum frame_decoder_result decoder_complete(struct frame_decoder *dec, struct frame *frame)
+{
+        uint16_t crc_reg = CRC16_REG_INITIALIZER;
+        size_t data_size = 0u;
+
+
+        if (dec->overflow || dec->block_left != 0u
+                        || dec->size < FRAME_HEADER_SIZE + FRAME_CRC_SIZE) {
+
+                dec->n_errors++;
+                return FRAME_DECODER_FORMAT_ERROR;
+        }
+
+        data_size = dec->size - FRAME_CRC_SIZE;
+        crc16_update(&crc_reg, dec->buf, data_size);
+
+        if ((uint8_t) (crc_reg & 0xffu) != dec->buf[data_size]
+                        || (uint8_t) (crc_reg >> 8) != dec->buf[data_size + 1u]) {
+
+                dec->n_errors++;
+                return FRAME_DECODER_CRC_ERROR;
+        }
+
+        frame->type = dec->buf[0];
+        frame->seq = dec->buf[1];
+        frame->payload = &dec->buf[FRAME_HEADER_SIZE];
+        frame->payload_size = data_size - FRAME_HEADER_SIZE;
+
+        /* Sequence numbers show how many frames were lost in between */
+        if (dec->has_seq)
+                dec->n_lost += (uint8_t) (frame->seq - dec->next_seq);
+
+        dec->next_seq = (uint8_t) (frame->seq + 1u);
+        dec->has_seq = true;
+        dec->n_frames++;
+
+
+        return FRAME_DECODER_OK;
+}
+
+enum frame_decoder_result frame_decoder_push(struct frame_decoder *dec, uint8_t byte,
+                                             struct frame *frame)
+{
+        enum frame_decoder_result result = FRAME_DECODER_INCOMPLETE;
+
+
+        if (byte == FRAME_DELIMITER) {
+                /* Empty frames (back-to-back delimiters) are used for resynchronization */
+                if (dec->size == 0u && dec->code == 0u)
+                        return FRAME_DECODER_INCOMPLETE;
+
+                result = decoder_complete(dec, frame);
+                decoder_restart(dec);
+                return result;
+        }
+
+        if (dec->block_left == 0u) {
+                /* NOTE: Zero implied by the previous block is added only now, never at the end */
+                if (dec->code != 0u && dec->code != 0xffu)
+                        decoder_append(dec, 0u);
+
+                dec->code = byte;
+                dec->block_left = (uint8_t) (byte - 1u);
+        } else {
+                decoder_append(dec, byte);
+                dec->block_left--;
+        }
+
+
+        return FRAME_DECODER_INCOMPLETE;
+}
@@ -0,0 +1,113 @@
+/*
+ * Copyright (c) 2018 Sereda Anton
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ */
+
+#ifndef FRAME_H
+#define FRAME_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "mem-chunk.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Binary frame before byte stuffing:
+ *
+ *      | type | seq | payload ... | crc16 low | crc16 high |
+ *
+ * CRC16 is the MODBUS RTU one and covers type, seq and payload. Frame is then
+ * COBS encoded, so it contains no zero bytes, and terminated by a single zero.
+ * This code has no AVR dependencies and is built into host tools as well.
+ */
+
+#ifndef FRAME_MAX_PAYLOAD_SIZE
+#define FRAME_MAX_PAYLOAD_SIZE  64
+#endif
+#define FRAME_HEADER_SIZE       2
+#define FRAME_CRC_SIZE          2
+#define FRAME_MAX_RAW_SIZE      (FRAME_HEADER_SIZE + FRAME_MAX_PAYLOAD_SIZE + FRAME_CRC_SIZE)
+
+/* NOTE: COBS adds one code byte per 254 data bytes, plus the leading code and the delimiter */
+#define FRAME_MAX_ENCODED_SIZE  (FRAME_MAX_RAW_SIZE + FRAME_MAX_RAW_SIZE / 254 + 2)
+
+#define FRAME_DELIMITER         0x00u
+
+enum frame_type {
+        FRAME_TYPE_TELEMETRY = 0x01,
+        FRAME_TYPE_SAMPLES = 0x02,
+        FRAME_TYPE_LOG = 0x03
+};
+
+enum frame_decoder_result {
+        FRAME_DECODER_INCOMPLETE = 0,
+        FRAME_DECODER_OK,
+        FRAME_DECODER_CRC_ERROR,
+        FRAME_DECODER_FORMAT_ERROR
+};
+
+struct frame {
+        uint8_t type;
+        uint8_t seq;
+
+        const uint8_t *payload;
+        size_t payload_size;
+};
+
+struct frame_encoder {
+        uint8_t seq;
+};
+
+struct frame_decoder {
+        uint8_t buf[FRAME_MAX_RAW_SIZE];
+        size_t size;
+
+        uint8_t code;
+        uint8_t block_left;
+        bool overflow;
+
+        uint8_t next_seq;
+        bool has_seq;
+
+        unsigned long n_frames;
+        unsigned long n_errors;
+        unsigned long n_lost;
+};
+
+void frame_encoder_init(struct frame_encoder *enc);
+bool frame_encode_chain(struct frame_encoder *enc, uint8_t type,
+                        const struct mem_chain *payload, struct mem_chunk *out);
+bool frame_encode(struct frame_encoder *enc, uint8_t type,
+                  const void *payload, size_t payload_size, struct mem_chunk *out);
+void frame_decoder_init(struct frame_decoder *dec);
+enum frame_decoder_result frame_decoder_push(struct frame_decoder *dec, uint8_t byte,
+                                             struct frame *frame);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* FRAME_H */
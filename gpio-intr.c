@@ -0,0 +1,436 @@
+#include <string.h>
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <util/atomic.h>
+
+#include "board.h"
+#include "gpio-intr.h"
+#include "hrtimer.h"
+#include "clock.h"
+
+/*
+ * NOTE: Sources 0..7 are external interrupts INTn, sources starting from
+ *       PCINT_SOURCE_BASE are pin change interrupts PCINTn. Both are listed
+ *       per MCU in board.h. If pin has both, external interrupt is used
+ *       (edge is selected in hardware).
+ */
+#define PCINT_SOURCE_BASE       8u
+#define N_PCINT_BANKS           ((uint8_t) BOARD_N_PCINT_BANKS)
+#define NO_SOURCE               0xffu
+
+static struct gpio_intr *lines[GPIO_INTR_MAX_LINES];
+
+static struct gpio_event event_queue[GPIO_INTR_EVENT_QUEUE_SIZE];
+static volatile uint8_t event_get_offset = 0u;
+static volatile uint8_t event_put_offset = 0u;
+static volatile uint8_t event_count = 0u;
+static volatile unsigned long event_overruns = 0ul;
+
+static uint8_t pcint_last_state[N_PCINT_BANKS];
+
+#define PIN_MASK(n_pins) ((uint8_t) ((1u << (n_pins)) - 1u))
+
+#define LOOKUP_EXTINT(n, port, pin_bit)                                                 \
+        if (port_letter == #port[0] && bit == (pin_bit))                                \
+                return (uint8_t) (n);
+
+#define LOOKUP_PCINT(bank, port, first_bit, first_pcint, n_pins)                        \
+        if (port_letter == #port[0] && (unsigned) (bit - (first_bit)) < (n_pins))      \
+                return (uint8_t) (PCINT_SOURCE_BASE + (first_pcint) + bit - (first_bit));
+
+static uint8_t lookup_source(char port_letter, unsigned bit)
+{
+        BOARD_EXTINT_LIST(LOOKUP_EXTINT)
+        BOARD_PCINT_LIST(LOOKUP_PCINT)
+
+
+        return NO_SOURCE;
+}
+
+static inline bool is_pcint_source(uint8_t source)
+{
+        return source >= PCINT_SOURCE_BASE;
+}
+
+#define PCINT_MASK_ADDR(n)                                                              \
+        if (bank == (n##u))                                                             \
+                return &PCMSK##n;
+
+static inline volatile uint8_t *pcint_mask_addr(uint8_t bank)
+{
+        BOARD_PCINT_BANK_LIST(PCINT_MASK_ADDR)
+
+
+        return NULL;
+}
+
+/* NOTE: Pins of a run are shifted into their PCINT positions within the bank */
+#define PCINT_READ_PINS(n, port, first_bit, first_pcint, n_pins)                        \
+        if (bank == (n##u)) {                                                           \
+                state |= (uint8_t) ((uint8_t) ((PIN##port >> (first_bit)) & PIN_MASK(n_pins)) \
+                                    << ((first_pcint) % 8u));                           \
+        }
+
+static inline uint8_t pcint_read_bank(uint8_t bank)
+{
+        uint8_t state = 0u;
+
+
+        BOARD_PCINT_LIST(PCINT_READ_PINS)
+
+
+        return state;
+}
+
+static void extint_enable(uint8_t n, uint8_t edge)
+{
+        volatile uint8_t *eicr_addr = NULL;
+        uint8_t shift = 0u;
+
+
+#ifdef EICRB
+        eicr_addr = (n < 4u) ? &EICRA : &EICRB;
+#else
+        eicr_addr = &EICRA;
+#endif
+        shift = (uint8_t) ((n % 4u) * 2u);
+
+        EIMSK &= (uint8_t) ~(_BV(n));
+        *eicr_addr = (uint8_t) ((*eicr_addr & (uint8_t) ~(0x03u << shift)) | (uint8_t) (edge << shift));
+        EIFR = (uint8_t) _BV(n);
+        EIMSK |= (uint8_t) _BV(n);
+}
+
+static void extint_disable(uint8_t n)
+{
+        EIMSK &= (uint8_t) ~(_BV(n));
+}
+
+static void pcint_enable(uint8_t pcint)
+{
+        uint8_t bank = 0u;
+
+
+        bank = (uint8_t) (pcint / 8u);
+        if (bank >= N_PCINT_BANKS)
+                return;
+
+        pcint_last_state[bank] = pcint_read_bank(bank);
+        *pcint_mask_addr(bank) |= (uint8_t) _BV(pcint % 8u);
+        PCIFR = (uint8_t) _BV(bank);
+        PCICR |= (uint8_t) _BV(bank);
+}
+
+static void pcint_disable(uint8_t pcint)
+{
+        uint8_t bank = 0u;
+        volatile uint8_t *mask_addr = NULL;
+
+
+        bank = (uint8_t) (pcint / 8u);
+        mask_addr = pcint_mask_addr(bank);
+
+        *mask_addr &= (uint8_t) ~(_BV(pcint % 8u));
+        if (*mask_addr == 0u)
+                PCICR &= (uint8_t) ~(_BV(bank));
+}
+
+void gpio_intr_init(struct gpio_intr *intr, gpio_intr_handler handler, void *arg)
+{
+        memset(intr, 0, sizeof(struct gpio_intr));
+
+        /* NOTE: Edges are stamped with Timer/Counter1 cycles */
+        hrtimer_setup();
+
+        intr->source = NO_SOURCE;
+        intr->handler = handler;
+        intr->arg = arg;
+}
+
+bool gpio_intr_has_source(struct gpio *port)
+{
+        if (!gpio_is_usable(port))
+                return false;
+
+
+        return lookup_source(gpio_get_port_letter(port), port->bit) != NO_SOURCE;
+}
+
+bool gpio_intr_attach(struct gpio_intr *intr, struct gpio *port,
+                      enum gpio_edge edge, uint16_t debounce_msec)
+{
+        uint8_t source = NO_SOURCE;
+        size_t i = 0u;
+        bool retval = false;
+
+
+        if (!gpio_is_usable(port))
+                return false;
+
+        source = lookup_source(gpio_get_port_letter(port), port->bit);
+        if (source == NO_SOURCE)
+                return false;
+
+        ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+                /* NOTE: Only one handler per source, any slot may hold it */
+                for (; i < GPIO_INTR_MAX_LINES; ++i) {
+                        if (lines[i] != NULL && lines[i]->source == source)
+                                break;
+                }
+
+                if (i == GPIO_INTR_MAX_LINES) {
+                        for (i = 0u; i < GPIO_INTR_MAX_LINES; ++i) {
+                                if (lines[i] == NULL)
+                                        break;
+                        }
+                }
+
+                if (i < GPIO_INTR_MAX_LINES && lines[i] == NULL) {
+                        gpio_set_direction(port, GPIO_DIRECTION_INPUT);
+
+                        intr->pin_addr = gpio_get_pin_addr(port->port_letter);
+                        intr->bit_mask = (uint8_t) _BV(port->bit);
+                        intr->edge = (uint8_t) edge;
+                        intr->debounce_msec = debounce_msec;
+                        intr->last_msec = 0ul;
+                        intr->has_last_edge = false;
+                        intr->count = 0ul;
+                        intr->source = source;
+                        lines[i] = intr;
+
+                        if (is_pcint_source(source))
+                                pcint_enable((uint8_t) (source - PCINT_SOURCE_BASE));
+                        else
+                                extint_enable(source, intr->edge);
+
+                        retval = true;
+                }
+        }
+
+
+        return retval;
+}
+
+void gpio_intr_detach(struct gpio_intr *intr)
+{
+        size_t i = 0u;
+
+
+        ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+                for (; i < GPIO_INTR_MAX_LINES; ++i) {
+                        if (lines[i] != intr)
+                                continue;
+
+                        if (is_pcint_source(intr->source))
+                                pcint_disable((uint8_t) (intr->source - PCINT_SOURCE_BASE));
+                        else
+                                extint_disable(intr->source);
+
+                        lines[i] = NULL;
+                        intr->source = NO_SOURCE;
+                }
+        }
+}
+
+unsigned long gpio_intr_get_count(struct gpio_intr *intr)
+{
+        unsigned long count = 0ul;
+
+
+        ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+                count = intr->count;
+        }
+
+
+        return count;
+}
+
+unsigned long gpio_intr_take_count(struct gpio_intr *intr)
+{
+        unsigned long count = 0ul;
+
+
+        ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+                count = intr->count;
+                intr->count = 0ul;
+        }
+
+
+        return count;
+}
+
+bool gpio_intr_get_event(struct gpio_event *event)
+{
+        bool retval = false;
+
+
+        ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+                if (event_count > 0u) {
+                        memcpy(event, &event_queue[event_get_offset], sizeof(struct gpio_event));
+
+                        event_get_offset = (uint8_t) ((event_get_offset + 1u) % GPIO_INTR_EVENT_QUEUE_SIZE);
+                        event_count--;
+
+                        retval = true;
+                }
+        }
+
+
+        return retval;
+}
+
+size_t gpio_intr_get_pending(void)
+{
+        return event_count;
+}
+
+unsigned long gpio_intr_get_overruns(void)
+{
+        unsigned long overruns = 0ul;
+
+
+        ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+                overruns = event_overruns;
+        }
+
+
+        return overruns;
+}
+
+static inline void event_push(struct gpio_intr *intr, enum gpio_state state,
+                              uint16_t cycles, unsigned long msec)
+{
+        struct gpio_event *event = NULL;
+
+
+        if (event_count >= GPIO_INTR_EVENT_QUEUE_SIZE) {
+                event_overruns++;
+                return;
+        }
+
+        event = &event_queue[event_put_offset];
+        event->intr = intr;
+        event->state = state;
+        event->cycles = cycles;
+        event->msec = msec;
+
+        event_put_offset = (uint8_t) ((event_put_offset + 1u) % GPIO_INTR_EVENT_QUEUE_SIZE);
+        event_count++;
+}
+
+static inline bool edge_matches(uint8_t edge, enum gpio_state state)
+{
+        if (edge == GPIO_EDGE_RISING)
+                return state == GPIO_STATE_HIGH;
+        else if (edge == GPIO_EDGE_FALLING)
+                return state == GPIO_STATE_LOW;
+
+
+        return true;
+}
+
+static void line_fire(struct gpio_intr *intr, enum gpio_state state, uint16_t cycles)
+{
+        unsigned long msec = 0ul;
+
+
+        /* NOTE: Handler is called from ISR context, fast decoders don't need system time */
+        if (intr->handler != NULL && intr->debounce_msec == 0u) {
+                intr->count++;
+                intr->handler(intr, state, cycles);
+                return;
+        }
+
+        msec = clock_get_msecs();
+
+        if (intr->debounce_msec != 0u) {
+                if (intr->has_last_edge && (msec - intr->last_msec) < intr->debounce_msec)
+                        return;
+
+                intr->last_msec = msec;
+                intr->has_last_edge = true;
+        }
+
+        intr->count++;
+
+        if (intr->handler != NULL)
+                intr->handler(intr, state, cycles);
+        else
+                event_push(intr, state, cycles, msec);
+}
+
+static inline __attribute__((always_inline)) void isr_extint_handler(uint8_t source)
+{
+        uint16_t cycles = 0u;
+        size_t i = 0u;
+        struct gpio_intr *intr = NULL;
+        enum gpio_state state = GPIO_STATE_LOW;
+
+
+        cycles = hrtimer_now();
+
+        for (; i < GPIO_INTR_MAX_LINES; ++i) {
+                intr = lines[i];
+                if (intr == NULL || intr->source != source)
+                        continue;
+
+                state = ((*( intr->pin_addr ) & intr->bit_mask) != 0u) ? GPIO_STATE_HIGH : GPIO_STATE_LOW;
+                line_fire(intr, state, cycles);
+                break;
+        }
+}
+
+#define DEFINE_EXTINT_ISR(n)                    \
+        ISR(INT##n##_vect)                      \
+        {                                       \
+                isr_extint_handler(n);          \
+        }
+
+#define EXTINT_ISR(n, port, bit) DEFINE_EXTINT_ISR(n)
+
+BOARD_EXTINT_LIST(EXTINT_ISR)
+
+static inline __attribute__((always_inline)) void isr_pcint_handler(uint8_t bank)
+{
+        uint16_t cycles = 0u;
+        uint8_t state = 0u;
+        uint8_t changed = 0u;
+        uint8_t bit = 0u;
+        size_t i = 0u;
+        struct gpio_intr *intr = NULL;
+        enum gpio_state pin_state = GPIO_STATE_LOW;
+
+
+        cycles = hrtimer_now();
+
+        state = pcint_read_bank(bank);
+        changed = (uint8_t) ((state ^ pcint_last_state[bank]) & *pcint_mask_addr(bank));
+        pcint_last_state[bank] = state;
+
+        for (; i < GPIO_INTR_MAX_LINES && changed != 0u; ++i) {
+                intr = lines[i];
+                if (intr == NULL || !is_pcint_source(intr->source))
+                        continue;
+
+                if ((uint8_t) ((intr->source - PCINT_SOURCE_BASE) / 8u) != bank)
+                        continue;
+
+                bit = (uint8_t) _BV((intr->source - PCINT_SOURCE_BASE) % 8u);
+                if ((changed & bit) == 0u)
+                        continue;
+
+                changed &= (uint8_t) ~bit;
+
+                pin_state = ((state & bit) != 0u) ? GPIO_STATE_HIGH : GPIO_STATE_LOW;
+                if (edge_matches(intr->edge, pin_state))
+                        line_fire(intr, pin_state, cycles);
+        }
+}
+
+#define DEFINE_PCINT_ISR(bank)                  \
+        ISR(PCINT##bank##_vect)                 \
+        {                                       \
+                isr_pcint_handler(bank);        \
+        }
+
+BOARD_PCINT_BANK_LIST(DEFINE_PCINT_ISR)
@@ -0,0 +1,91 @@
+/*
+ * Copyright (c) 2018 Sereda Anton
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ */
+
+#ifndef GPIO_INTR_H
+#define GPIO_INTR_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "gpio.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define GPIO_INTR_MAX_LINES             8
+#define GPIO_INTR_EVENT_QUEUE_SIZE      16
+
+/* NOTE: Values match ISCn1:ISCn0 bits of external interrupt control registers */
+enum gpio_edge {
+        GPIO_EDGE_ANY = 1,
+        GPIO_EDGE_FALLING = 2,
+        GPIO_EDGE_RISING = 3
+};
+
+struct gpio_intr;
+
+typedef void (*gpio_intr_handler)(struct gpio_intr *intr, enum gpio_state state, uint16_t cycles);
+
+struct gpio_intr {
+        const volatile uint8_t *pin_addr;
+        uint8_t bit_mask;
+
+        uint8_t source;
+        uint8_t edge;
+
+        uint16_t debounce_msec;
+        unsigned long last_msec;
+        bool has_last_edge;     /* Edge accepted since attach, count may be taken */
+        volatile unsigned long count;
+
+        gpio_intr_handler handler;
+        void *arg;
+};
+
+struct gpio_event {
+        struct gpio_intr *intr;
+        enum gpio_state state;
+
+        /* Timer/Counter1 value (CPU cycles) and system time of the edge */
+        uint16_t cycles;
+        unsigned long msec;
+};
+
+void gpio_intr_init(struct gpio_intr *intr, gpio_intr_handler handler, void *arg);
+bool gpio_intr_has_source(struct gpio *port);
+bool gpio_intr_attach(struct gpio_intr *intr, struct gpio *port,
+                      enum gpio_edge edge, uint16_t debounce_msec);
+void gpio_intr_detach(struct gpio_intr *intr);
+unsigned long gpio_intr_get_count(struct gpio_intr *intr);
+unsigned long gpio_intr_take_count(struct gpio_intr *intr);
+bool gpio_intr_get_event(struct gpio_event *event);
+size_t gpio_intr_get_pending(void);
+unsigned long gpio_intr_get_overruns(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* GPIO_INTR_H */
@@ -2,26 +2,27 @@
 #include <stdio.h>
 #include <avr/io.h>
 #include <avr/pgmspace.h>
+#include <util/atomic.h>
 
+#include "board.h"
 #include "gpio.h"
 
-static struct gpio_addr_table addr_tables[] = {
-        [0] = { &PINA, &PORTA, &DDRA },
-        [1] = { &PINB, &PORTB, &DDRB },
-        [2] = { &PINC, &PORTC, &DDRC },
-        [3] = { &PIND, &PORTD, &DDRD },
-        [4] = { &PINE, &PORTE, &DDRE },
-        [5] = { &PINF, &PORTF, &DDRF },
-        [6] = { &PING, &PORTG, &DDRG },
-        [7] = { &PINH, &PORTH, &DDRH },
-        [9] = { &PINJ, &PORTJ, &DDRJ },
-        [10] = { &PINK, &PORTK, &DDRK },
-        [11] = { &PINL, &PORTL, &DDRL }
+/* NOTE: Table is indexed by port letter, so it has empty slots for ports the MCU lacks */
+#define PORT_ADDR_TABLE(letter, port) \
+        [(letter) - 'A'] = { &PIN##port, &PORT##port, &DDR##port },
+
+static struct gpio_addr_table const addr_tables[] PROGMEM = {
+        BOARD_GPIO_PORT_LIST(PORT_ADDR_TABLE)
 };
 
+#define PORT_LETTER(letter, port) letter,
+
+#define ADDR_TABLE_GET(port_letter, name) \
+        ((volatile uint8_t *) pgm_read_ptr(&addr_tables[(port_letter) - 'A'].name##_addr))
+
 static inline bool is_valid_port_letter(int port_letter)
 {
-        static char const port_letters[] PROGMEM = "ABCDEFGHJKL";
+        static char const port_letters[] PROGMEM = { BOARD_GPIO_PORT_LIST(PORT_LETTER) };
         size_t i = 0u;
 
 
@@ -35,21 +36,41 @@ static inline bool is_valid_port_letter(int port_letter)
         return false;
 }
 
-bool gpio_init(struct gpio *port, const char *params)
+bool gpio_parse_params(struct gpio_params *params, const char *str)
 {
         char port_letter = 0;
         unsigned port_bit = 0u;
 
 
-        if (params == NULL)
+        memset(params, 0, sizeof(struct gpio_params));
+
+        if (str == NULL)
                 return false;
 
-        if (sscanf_P(params, PSTR("PORT%c:%u"), &port_letter, &port_bit) != 2)
+        if (sscanf_P(str, PSTR("PORT%c:%u"), &port_letter, &port_bit) != 2 || port_bit > 7u)
                 return false;
 
-        if (is_valid_port_letter(port_letter) && port_bit <= 7) {
-                port->addr_table = &addr_tables[port_letter - 'A'];
-                port->bit = port_bit;
+        params->port_letter = port_letter;
+        params->bit = (uint8_t) port_bit;
+
+
+        return true;
+}
+
+bool gpio_parse_params_P(struct gpio_params *params, const char *str)
+{
+        char buf[10] = {0, };
+
+
+        strncpy_P(buf, str, sizeof(buf) - 1);
+        return gpio_parse_params(params, buf);
+}
+
+bool gpio_init_params(struct gpio *port, const struct gpio_params *params)
+{
+        if (is_valid_port_letter(params->port_letter) && params->bit <= 7u) {
+                port->port_letter = params->port_letter;
+                port->bit = params->bit;
                 port->direction = GPIO_DIRECTION_INPUT;
                 return true;
         }
@@ -58,6 +79,18 @@ bool gpio_init(struct gpio *port, const char *params)
         return false;
 }
 
+bool gpio_init(struct gpio *port, const char *params)
+{
+        struct gpio_params parsed;
+
+
+        if (!gpio_parse_params(&parsed, params))
+                return false;
+
+
+        return gpio_init_params(port, &parsed);
+}
+
 bool gpio_init_P(struct gpio *port, const char *params)
 {
         char buf[10] = {0, };
@@ -67,18 +100,41 @@ bool gpio_init_P(struct gpio *port, const char *params)
         return gpio_init(port, buf);
 }
 
+char gpio_get_port_letter(struct gpio *port)
+{
+        return port->port_letter;
+}
+
+volatile uint8_t *gpio_get_pin_addr(char port_letter)
+{
+        return ADDR_TABLE_GET(port_letter, pin);
+}
+
+volatile uint8_t *gpio_get_port_addr(char port_letter)
+{
+        return ADDR_TABLE_GET(port_letter, port);
+}
+
+volatile uint8_t *gpio_get_ddr_addr(char port_letter)
+{
+        return ADDR_TABLE_GET(port_letter, ddr);
+}
+
 void gpio_set_direction(struct gpio *port, enum gpio_direction dir)
 {
         volatile uint8_t *ddr_addr = NULL;
 
 
-        ddr_addr = port->addr_table->ddr_addr;
+        if (!gpio_is_usable(port))
+                return;
+
+        ddr_addr = ADDR_TABLE_GET(port->port_letter, ddr);
         if (dir == GPIO_DIRECTION_INPUT)
                 *ddr_addr &= (uint8_t) ~(_BV(port->bit));
         else
                 *ddr_addr |= (uint8_t) _BV(port->bit);
 
-        port->direction = dir;
+        port->direction = (uint8_t) dir;
 }
 
 enum gpio_state gpio_read(struct gpio *port)
@@ -87,10 +143,13 @@ enum gpio_state gpio_read(struct gpio *port)
         const volatile uint8_t *pin_addr = NULL;
 
 
+        if (!gpio_is_usable(port))
+                return GPIO_STATE_LOW;
+
         if (gpio_get_direction(port) != GPIO_DIRECTION_INPUT)
                 gpio_set_direction(port, GPIO_DIRECTION_INPUT);
 
-        pin_addr = port->addr_table->pin_addr;
+        pin_addr = ADDR_TABLE_GET(port->port_letter, pin);
         value = *pin_addr;
         if (value & (uint8_t)(_BV(port->bit)))
                 return GPIO_STATE_HIGH;
@@ -104,12 +163,107 @@ void gpio_write(struct gpio *port, enum gpio_state state)
         volatile uint8_t *port_addr = NULL;
 
 
+        if (!gpio_is_usable(port))
+                return;
+
         if (gpio_get_direction(port) != GPIO_DIRECTION_OUTPUT)
                 gpio_set_direction(port, GPIO_DIRECTION_OUTPUT);
 
-        port_addr = port->addr_table->port_addr;
+        port_addr = ADDR_TABLE_GET(port->port_letter, port);
         if (state == GPIO_STATE_HIGH)
                 *port_addr |= (uint8_t) _BV(port->bit);
         else
                 *port_addr &= (uint8_t) ~(_BV(port->bit));
 }
+
+bool gpio_group_init(struct gpio_group *group, const char *params)
+{
+        char port_letter = 0;
+        unsigned mask = 0u;
+
+
+        if (params == NULL)
+                return false;
+
+        /* NOTE: Format is "PORTA&0xf0", mask selects pins of the group */
+        if (sscanf_P(params, PSTR("PORT%c&%x"), &port_letter, &mask) != 2)
+                return false;
+
+        if (is_valid_port_letter(port_letter) && mask != 0u && mask <= 0xffu) {
+                group->port_letter = port_letter;
+                group->mask = (uint8_t) mask;
+                return true;
+        }
+
+
+        return false;
+}
+
+bool gpio_group_init_P(struct gpio_group *group, const char *params)
+{
+        char buf[12] = {0, };
+
+
+        strncpy_P(buf, params, sizeof(buf) - 1);
+        return gpio_group_init(group, buf);
+}
+
+void gpio_group_set_direction(struct gpio_group *group, enum gpio_direction dir)
+{
+        volatile uint8_t *ddr_addr = NULL;
+
+
+        if (!gpio_group_is_usable(group))
+                return;
+
+        ddr_addr = ADDR_TABLE_GET(group->port_letter, ddr);
+
+        ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+                if (dir == GPIO_DIRECTION_INPUT)
+                        *ddr_addr &= (uint8_t) ~(group->mask);
+                else
+                        *ddr_addr |= group->mask;
+        }
+}
+
+uint8_t gpio_group_read(struct gpio_group *group)
+{
+        if (!gpio_group_is_usable(group))
+                return 0u;
+
+
+        return (uint8_t) (*( ADDR_TABLE_GET(group->port_letter, pin) ) & group->mask);
+}
+
+void gpio_group_write(struct gpio_group *group, uint8_t value)
+{
+        volatile uint8_t *port_addr = NULL;
+        uint8_t mask = 0u;
+
+
+        if (!gpio_group_is_usable(group))
+                return;
+
+        port_addr = ADDR_TABLE_GET(group->port_letter, port);
+        mask = group->mask;
+
+        ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+                *port_addr = (uint8_t) ((*port_addr & (uint8_t) ~mask) | (value & mask));
+        }
+}
+
+void gpio_group_toggle(struct gpio_group *group, uint8_t bits)
+{
+        volatile uint8_t *pin_addr = NULL;
+
+
+        if (!gpio_group_is_usable(group))
+                return;
+
+        /*
+         * NOTE: Writing one to PINx toggles PORTx bit in hardware, so this is
+         *       a single store and needs no read-modify-write protection
+         */
+        pin_addr = ADDR_TABLE_GET(group->port_letter, pin);
+        *pin_addr = (uint8_t) (bits & group->mask);
+}
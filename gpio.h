@@ -27,6 +27,8 @@
 #include <stddef.h>
 #include <stdint.h>
 #include <stdbool.h>
+#include <avr/io.h>
+#include <util/atomic.h>
 
 #ifdef __cplusplus
 extern "C" {
@@ -42,33 +44,133 @@ enum gpio_direction {
         GPIO_DIRECTION_OUTPUT
 };
 
+/*
+ * Compile-time pin descriptors: GPIO_PIN(B, 7) expands to a port letter and a bit number,
+ * so every GPIO_PIN_* accessor below resolves to a constant register address. For ports A-G
+ * this is a single sbi/cbi/sbic/sbis instruction, which is atomic on its own.
+ *
+ * NOTE: On ATmega2560 ports H-L live outside of the bit-addressable I/O space, so set/clear
+ *       there is a lds/sts read-modify-write sequence and needs ATOMIC_BLOCK if an ISR
+ *       touches the same port. GPIO_PIN_TOGGLE is a single store on every port.
+ */
+#define GPIO_PIN(port, bit) port, bit
+
+#define GPIO_PIN_OUTPUT(pin)            _GPIO_PIN_OUTPUT(pin)
+#define GPIO_PIN_INPUT(pin)             _GPIO_PIN_INPUT(pin)
+#define GPIO_PIN_HIGH(pin)              _GPIO_PIN_HIGH(pin)
+#define GPIO_PIN_LOW(pin)               _GPIO_PIN_LOW(pin)
+#define GPIO_PIN_TOGGLE(pin)            _GPIO_PIN_TOGGLE(pin)
+#define GPIO_PIN_IS_HIGH(pin)           _GPIO_PIN_IS_HIGH(pin)
+#define GPIO_PIN_READ(pin)              _GPIO_PIN_READ(pin)
+#define GPIO_PIN_WRITE(pin, state)      _GPIO_PIN_WRITE(pin, state)
+
+/* NOTE: Extra level of expansion is needed to split GPIO_PIN() into macro arguments */
+#define _GPIO_PIN_OUTPUT(port, bit)     (DDR##port |= (uint8_t) _BV(bit))
+#define _GPIO_PIN_INPUT(port, bit)      (DDR##port &= (uint8_t) ~(_BV(bit)))
+#define _GPIO_PIN_HIGH(port, bit)       (PORT##port |= (uint8_t) _BV(bit))
+#define _GPIO_PIN_LOW(port, bit)        (PORT##port &= (uint8_t) ~(_BV(bit)))
+#define _GPIO_PIN_TOGGLE(port, bit)     (PIN##port = (uint8_t) _BV(bit))
+#define _GPIO_PIN_IS_HIGH(port, bit)    ((PIN##port & (uint8_t) _BV(bit)) != 0u)
+#define _GPIO_PIN_READ(port, bit)                                               \
+        (_GPIO_PIN_IS_HIGH(port, bit) ? GPIO_STATE_HIGH : GPIO_STATE_LOW)
+#define _GPIO_PIN_WRITE(port, bit, state)                                       \
+        do {                                                                    \
+                if ((state) == GPIO_STATE_HIGH)                                 \
+                        _GPIO_PIN_HIGH(port, bit);                              \
+                else                                                            \
+                        _GPIO_PIN_LOW(port, bit);                               \
+        } while (0)
+
+/*
+ * Compile-time group of pins on one port: GPIO_GROUP(A, 0xf0) covers PA4..PA7.
+ * Masked write is done with interrupts disabled, so all pins change on the same cycle.
+ */
+#define GPIO_GROUP(port, mask) port, mask
+
+#define GPIO_GROUP_OUTPUT(group)        _GPIO_GROUP_OUTPUT(group)
+#define GPIO_GROUP_INPUT(group)         _GPIO_GROUP_INPUT(group)
+#define GPIO_GROUP_READ(group)          _GPIO_GROUP_READ(group)
+#define GPIO_GROUP_WRITE(group, value)  _GPIO_GROUP_WRITE(group, value)
+#define GPIO_GROUP_TOGGLE(group, bits)  _GPIO_GROUP_TOGGLE(group, bits)
+
+#define _GPIO_GROUP_OUTPUT(port, mask)                                          \
+        ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {                                     \
+                DDR##port |= (uint8_t) (mask);                                  \
+        }
+#define _GPIO_GROUP_INPUT(port, mask)                                           \
+        ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {                                     \
+                DDR##port &= (uint8_t) ~(mask);                                 \
+        }
+#define _GPIO_GROUP_READ(port, mask)    ((uint8_t) (PIN##port & (uint8_t) (mask)))
+#define _GPIO_GROUP_WRITE(port, mask, value)                                    \
+        ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {                                     \
+                PORT##port = (uint8_t) ((PORT##port & (uint8_t) ~(mask))        \
+                                        | ((uint8_t) (value) & (uint8_t) (mask))); \
+        }
+#define _GPIO_GROUP_TOGGLE(port, mask, bits)                                    \
+        (PIN##port = (uint8_t) ((uint8_t) (bits) & (uint8_t) (mask)))
+
+/*
+ * NOTE: Register addresses of each port are kept in PROGMEM table, run-time descriptors
+ *       hold only the port letter ('\0' if not configured), bit numbers and direction.
+ */
 struct gpio_addr_table {
-        const volatile uint8_t *pin_addr;
+        volatile uint8_t *pin_addr;
         volatile uint8_t *port_addr;
         volatile uint8_t *ddr_addr;
 };
 
 struct gpio {
-        const struct gpio_addr_table *addr_table;
-        enum gpio_direction direction;
-        unsigned bit;
+        char port_letter;
+        uint8_t bit;
+        uint8_t direction;
+};
+
+/* NOTE: Pre-parsed "PORT<letter>:<bit>" parameters, as kept in EEPROM config */
+struct gpio_params {
+        char port_letter;
+        uint8_t bit;
+};
+
+struct gpio_group {
+        char port_letter;
+        uint8_t mask;
 };
 
 static inline enum gpio_direction gpio_get_direction(struct gpio *port)
 {
-        return port->direction;
+        return (enum gpio_direction) port->direction;
 }
 
 static inline bool gpio_is_usable(struct gpio *port)
 {
-        return port->addr_table != NULL;
+        return port->port_letter != '\0';
+}
+
+/* NOTE: Port letter indexes the register table, so accessors refuse unconfigured pins */
+static inline bool gpio_group_is_usable(struct gpio_group *group)
+{
+        return group->port_letter != '\0';
 }
 
+bool gpio_parse_params(struct gpio_params *params, const char *str);
+bool gpio_parse_params_P(struct gpio_params *params, const char *str);
+bool gpio_init_params(struct gpio *port, const struct gpio_params *params);
 bool gpio_init(struct gpio *port, const char *params);
 bool gpio_init_P(struct gpio *port, const char *params);
+char gpio_get_port_letter(struct gpio *port);
+volatile uint8_t *gpio_get_pin_addr(char port_letter);
+volatile uint8_t *gpio_get_port_addr(char port_letter);
+volatile uint8_t *gpio_get_ddr_addr(char port_letter);
 void gpio_set_direction(struct gpio *port, enum gpio_direction dir);
 enum gpio_state gpio_read(struct gpio *port);
 void gpio_write(struct gpio *port, enum gpio_state state);
+bool gpio_group_init(struct gpio_group *group, const char *params);
+bool gpio_group_init_P(struct gpio_group *group, const char *params);
+void gpio_group_set_direction(struct gpio_group *group, enum gpio_direction dir);
+uint8_t gpio_group_read(struct gpio_group *group);
+void gpio_group_write(struct gpio_group *group, uint8_t value);
+void gpio_group_toggle(struct gpio_group *group, uint8_t bits);
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,23 @@
+#include <stdbool.h>
+#include <avr/io.h>
+#include <util/atomic.h>
+
+#include "hrtimer.h"
+
+void hrtimer_setup(void)
+{
+        static bool is_ready = false;
+
+
+        if (!is_ready) {
+                ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+                        TCCR1A = (uint8_t) 0u;          /* Normal mode, output compare pins disconnected */
+                        TCCR1B = (uint8_t) 0u;
+                        TIMSK1 = (uint8_t) 0u;          /* We never need overflow interrupts here */
+                        TCNT1 = (uint16_t) 0u;
+                        TCCR1B = (uint8_t)(_BV(CS10));  /* Start Timer/Counter (No prescaling) */
+                }
+
+                is_ready = true;
+        }
+}
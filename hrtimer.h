@@ -0,0 +1,67 @@
+/*
+ * Copyright (c) 2018 Sereda Anton
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ */
+
+#ifndef HRTIMER_H
+#define HRTIMER_H
+
+#include <stdint.h>
+#include <avr/io.h>
+#include <util/atomic.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * NOTE: Timer/Counter1 runs without prescaler, so one tick is exactly one CPU cycle.
+ *       Counter wraps every 65536 cycles (~4ms at 16Mhz), so only intervals
+ *       shorter than that can be measured with a plain subtraction.
+ */
+#define HRTIMER_CYCLES_PER_USEC ((uint16_t) (F_CPU / 1000000ul))
+
+void hrtimer_setup(void);
+
+static inline uint16_t hrtimer_now(void)
+{
+        uint16_t value = 0u;
+
+
+        /* NOTE: 16-bit read goes through shared TEMP register, so it must not be interrupted */
+        ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+                value = TCNT1;
+        }
+
+
+        return value;
+}
+
+static inline uint16_t hrtimer_elapsed(uint16_t since)
+{
+        return (uint16_t) (hrtimer_now() - since);
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* HRTIMER_H */
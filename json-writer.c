@@ -0,0 +1,281 @@
+#include <string.h>
+#include <avr/pgmspace.h>
+
+#include "json-writer.h"
+
+/* Longest value is "-2147483648" */
+#define NUMBER_BUF_SIZE 12
+
+static bool uart_put(struct json_writer *w, uint8_t byte)
+{
+        /* NOTE: Byte goes straight into TX FIFO, we flush only when it is full */
+        return uart_write_byte((struct uart *) w->sink, byte, 0) == UART_RESULT_OK;
+}
+
+static bool chunk_put(struct json_writer *w, uint8_t byte)
+{
+        struct mem_chunk *chunk = NULL;
+
+
+        chunk = (struct mem_chunk *) w->sink;
+
+        /* NOTE: Last byte is reserved for terminating NUL */
+        if (chunk->offset + 1u >= chunk->size)
+                return false;
+
+        ((uint8_t *) chunk->ptr)[chunk->offset++] = byte;
+
+
+        return true;
+}
+
+static void writer_clear(struct json_writer *w)
+{
+        memset(w, 0, sizeof(struct json_writer));
+}
+
+void json_writer_init_uart(struct json_writer *w, struct uart *dev)
+{
+        writer_clear(w);
+
+        w->put = uart_put;
+        w->sink = dev;
+}
+
+void json_writer_init_chunk(struct json_writer *w, struct mem_chunk *chunk)
+{
+        writer_clear(w);
+
+        w->put = chunk_put;
+        w->sink = chunk;
+}
+
+static inline void put_byte(struct json_writer *w, uint8_t byte)
+{
+        if (!w->failed && !w->put(w, byte))
+                w->failed = true;
+}
+
+static void put_str_P(struct json_writer *w, const char *str)
+{
+        uint8_t byte = 0u;
+
+
+        while ((byte = pgm_read_byte(str++)) != 0u)
+                put_byte(w, byte);
+}
+
+static void begin_value(struct json_writer *w)
+{
+        uint8_t level_bit = 0u;
+
+
+        level_bit = (uint8_t) (1u << w->depth);
+
+        if (w->after_key)
+                w->after_key = false;
+        else if ((w->need_comma & level_bit) != 0u)
+                put_byte(w, (uint8_t) ',');
+
+        w->need_comma |= level_bit;
+}
+
+static void begin_container(struct json_writer *w, uint8_t bracket)
+{
+        begin_value(w);
+        put_byte(w, bracket);
+
+        if (w->depth + 1u >= JSON_WRITER_MAX_DEPTH) {
+                w->failed = true;
+                return;
+        }
+
+        w->depth++;
+        w->need_comma &= (uint8_t) ~(1u << w->depth);
+}
+
+static void end_container(struct json_writer *w, uint8_t bracket)
+{
+        if (w->depth == 0u) {
+                w->failed = true;
+                return;
+        }
+
+        w->depth--;
+        w->after_key = false;
+        put_byte(w, bracket);
+}
+
+void json_writer_begin_object(struct json_writer *w)
+{
+        begin_container(w, (uint8_t) '{');
+}
+
+void json_writer_end_object(struct json_writer *w)
+{
+        end_container(w, (uint8_t) '}');
+}
+
+void json_writer_begin_array(struct json_writer *w)
+{
+        begin_container(w, (uint8_t) '[');
+}
+
+void json_writer_end_array(struct json_writer *w)
+{
+        end_container(w, (uint8_t) ']');
+}
+
+static void put_escaped(struct json_writer *w, uint8_t byte)
+{
+        static char const hex_digits[] PROGMEM = "0123456789abcdef";
+
+
+        if (byte == '"' || byte == '\\') {
+                put_byte(w, (uint8_t) '\\');
+                put_byte(w, byte);
+        } else if (byte == '\n') {
+                put_str_P(w, PSTR("\\n"));
+        } else if (byte == '\r') {
+                put_str_P(w, PSTR("\\r"));
+        } else if (byte == '\t') {
+                put_str_P(w, PSTR("\\t"));
+        } else if (byte < 0x20u) {
+                put_str_P(w, PSTR("\\u00"));
+                put_byte(w, pgm_read_byte(&hex_digits[byte >> 4]));
+                put_byte(w, pgm_read_byte(&hex_digits[byte & 0x0fu]));
+        } else
+                put_byte(w, byte);
+}
+
+void json_writer_key_P(struct json_writer *w, const char *key)
+{
+        uint8_t byte = 0u;
+
+
+        begin_value(w);
+
+        put_byte(w, (uint8_t) '"');
+        while ((byte = pgm_read_byte(key++)) != 0u)
+                put_escaped(w, byte);
+        put_str_P(w, PSTR("\":"));
+
+        w->after_key = true;
+}
+
+void json_writer_string(struct json_writer *w, const char *str)
+{
+        begin_value(w);
+
+        put_byte(w, (uint8_t) '"');
+        while (*str != '\0')
+                put_escaped(w, (uint8_t) *str++);
+        put_byte(w, (uint8_t) '"');
+}
+
+void json_writer_string_P(struct json_writer *w, const char *str)
+{
+        uint8_t byte = 0u;
+
+
+        begin_value(w);
+
+        put_byte(w, (uint8_t) '"');
+        while ((byte = pgm_read_byte(str++)) != 0u)
+                put_escaped(w, byte);
+        put_byte(w, (uint8_t) '"');
+}
+
+static void put_number(struct json_writer *w, bool negative, unsigned long magnitude,
+                       uint8_t n_decimals)
+{
+        char digits[NUMBER_BUF_SIZE];
+        size_t n_digits = 0u;
+
+
+        /* Digits are produced from the least significant one, with leading zero before point */
+        do {
+                digits[n_digits++] = (char) ('0' + (magnitude % 10u));
+                magnitude /= 10u;
+        } while ((magnitude != 0u || n_digits <= n_decimals) && n_digits < NUMBER_BUF_SIZE);
+
+        if (negative)
+                put_byte(w, (uint8_t) '-');
+
+        while (n_digits > 0u) {
+                if (n_digits == n_decimals)
+                        put_byte(w, (uint8_t) '.');
+
+                put_byte(w, (uint8_t) digits[--n_digits]);
+        }
+}
+
+static inline unsigned long long_magnitude(long value)
+{
+        /* NOTE: Works for LONG_MIN too */
+        return (value < 0) ? (unsigned long) -(value + 1) + 1u : (unsigned long) value;
+}
+
+void json_writer_int(struct json_writer *w, long value)
+{
+        begin_value(w);
+        put_number(w, value < 0, long_magnitude(value), 0u);
+}
+
+void json_writer_uint(struct json_writer *w, unsigned long value)
+{
+        begin_value(w);
+        put_number(w, false, value, 0u);
+}
+
+void json_writer_fixed(struct json_writer *w, long value, uint8_t n_decimals)
+{
+        begin_value(w);
+
+        if (n_decimals >= NUMBER_BUF_SIZE - 1u) {
+                w->failed = true;
+                return;
+        }
+
+        put_number(w, value < 0, long_magnitude(value), n_decimals);
+}
+
+void json_writer_bool(struct json_writer *w, bool value)
+{
+        begin_value(w);
+
+        if (value)
+                put_str_P(w, PSTR("true"));
+        else
+                put_str_P(w, PSTR("false"));
+}
+
+void json_writer_null(struct json_writer *w)
+{
+        begin_value(w);
+        put_str_P(w, PSTR("null"));
+}
+
+bool json_writer_finish(struct json_writer *w)
+{
+        struct uart *dev = NULL;
+        struct mem_chunk *chunk = NULL;
+
+
+        if (w->depth != 0u)
+                w->failed = true;
+
+        if (w->put == uart_put) {
+                /* Start transmission of what is left in TX FIFO, we don't wait for it */
+                dev = (struct uart *) w->sink;
+                dev->intr_tx_enable(dev->hw);
+
+        } else if (w->put == chunk_put) {
+                chunk = (struct mem_chunk *) w->sink;
+                if (chunk->offset < chunk->size)
+                        ((uint8_t *) chunk->ptr)[chunk->offset] = 0u;
+        }
+
+
+        return !w->failed;
+}
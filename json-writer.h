@@ -0,0 +1,70 @@
+/*
+ * Copyright (c) 2018 Sereda Anton
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ */
+
+#ifndef JSON_WRITER_H
+#define JSON_WRITER_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "uart.h"
+#include "mem-chunk.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define JSON_WRITER_MAX_DEPTH 8
+
+struct json_writer {
+        bool (*put)(struct json_writer *, uint8_t);
+        void *sink;
+
+        uint8_t depth;
+        uint8_t need_comma;     /* One bit per nesting level */
+        bool after_key;
+        bool failed;
+};
+
+void json_writer_init_uart(struct json_writer *w, struct uart *dev);
+void json_writer_init_chunk(struct json_writer *w, struct mem_chunk *chunk);
+void json_writer_begin_object(struct json_writer *w);
+void json_writer_end_object(struct json_writer *w);
+void json_writer_begin_array(struct json_writer *w);
+void json_writer_end_array(struct json_writer *w);
+void json_writer_key_P(struct json_writer *w, const char *key);
+void json_writer_int(struct json_writer *w, long value);
+void json_writer_uint(struct json_writer *w, unsigned long value);
+void json_writer_fixed(struct json_writer *w, long value, uint8_t n_decimals);
+void json_writer_bool(struct json_writer *w, bool value);
+void json_writer_null(struct json_writer *w);
+void json_writer_string(struct json_writer *w, const char *str);
+void json_writer_string_P(struct json_writer *w, const char *str);
+bool json_writer_finish(struct json_writer *w);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* JSON_WRITER_H */
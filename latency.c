@@ -0,0 +1,106 @@
+#include <stdio.h>
+#include <string.h>
+#include <avr/pgmspace.h>
+#include <util/atomic.h>
+
+#include "latency.h"
+
+#ifdef LATENCY_ENABLE
+
+static struct latency_stats stats;
+
+static char const site_name_fifo_buffer[] PROGMEM = "fifo_buffer";
+static char const site_name_clock[] PROGMEM = "clock";
+static char const site_name_dhtxx_poll[] PROGMEM = "dhtxx_poll";
+static char const site_name_uart_rx_isr[] PROGMEM = "uart_rx_isr";
+static char const site_name_uart_udre_isr[] PROGMEM = "uart_udre_isr";
+static char const site_name_clock_isr[] PROGMEM = "clock_isr";
+static char const site_name_uart_stats[] PROGMEM = "uart_stats";
+
+static const char * const site_names[N_LATENCY_SITES] PROGMEM = {
+        [LATENCY_SITE_FIFO_BUFFER] = site_name_fifo_buffer,
+        [LATENCY_SITE_CLOCK] = site_name_clock,
+        [LATENCY_SITE_DHTXX_POLL] = site_name_dhtxx_poll,
+        [LATENCY_SITE_UART_RX_ISR] = site_name_uart_rx_isr,
+        [LATENCY_SITE_UART_UDRE_ISR] = site_name_uart_udre_isr,
+        [LATENCY_SITE_CLOCK_ISR] = site_name_clock_isr,
+        [LATENCY_SITE_UART_STATS] = site_name_uart_stats
+};
+
+void latency_reset(void)
+{
+        ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+                memset(&stats, 0, sizeof(struct latency_stats));
+        }
+}
+
+void latency_setup(void)
+{
+        hrtimer_setup();
+        latency_reset();
+}
+
+void latency_record(enum latency_site site, uint16_t cycles)
+{
+        if ((size_t) site >= N_LATENCY_SITES)
+                return;
+
+        ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+                if (cycles > stats.site_worst_cycles[site])
+                        stats.site_worst_cycles[site] = cycles;
+
+                if (cycles > stats.worst_cycles) {
+                        stats.worst_cycles = cycles;
+                        stats.worst_site = (uint8_t) site;
+                }
+        }
+}
+
+void latency_tick(uint8_t timer_ticks_late, uint16_t cycles_per_timer_tick)
+{
+        uint16_t cycles = 0u;
+
+
+        cycles = (uint16_t) (timer_ticks_late * cycles_per_timer_tick);
+
+        ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+                if (stats.n_ticks != UINT32_MAX) {
+                        stats.n_ticks++;
+                        stats.tick_jitter_total += cycles;
+                }
+
+                if (cycles > stats.tick_jitter_max)
+                        stats.tick_jitter_max = cycles;
+        }
+}
+
+void latency_get_stats(struct latency_stats *store)
+{
+        ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+                memcpy(store, &stats, sizeof(struct latency_stats));
+        }
+}
+
+void latency_dump(void)
+{
+        struct latency_stats s;
+        size_t i = 0u;
+
+
+        latency_get_stats(&s);
+
+        printf_P(PSTR("// latency: worst %u cycles at %S\n"), s.worst_cycles,
+                 (const char *) pgm_read_ptr(&site_names[s.worst_site]));
+
+        for (; i < N_LATENCY_SITES; ++i) {
+                printf_P(PSTR("%S %u\n"), (const char *) pgm_read_ptr(&site_names[i]),
+                         s.site_worst_cycles[i]);
+        }
+
+        printf_P(PSTR("// tick jitter: max %u avg %lu cycles over %lu ticks\n"),
+                 s.tick_jitter_max,
+                 (unsigned long) ((s.n_ticks != 0u) ? s.tick_jitter_total / s.n_ticks : 0u),
+                 (unsigned long) s.n_ticks);
+}
+
+#endif /* LATENCY_ENABLE */
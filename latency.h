@@ -0,0 +1,156 @@
+/*
+ * Copyright (c) 2018 Sereda Anton
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ */
+
+#ifndef LATENCY_H
+#define LATENCY_H
+
+#include <stdint.h>
+#include <avr/io.h>
+#include <util/atomic.h>
+
+#include "hrtimer.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * NOTE: Latency tracking is compiled in only when LATENCY_ENABLE is defined (make latency=1),
+ *       otherwise LATENCY_ATOMIC_BLOCK is a plain ATOMIC_BLOCK and the other markers vanish.
+ *
+ *       Only the outermost interrupts-disabled window is measured: a block entered with
+ *       interrupts already disabled (e.g. a FIFO operation called from an ISR) is a part of
+ *       the enclosing window and it is not recorded separately. Windows longer than
+ *       one Timer/Counter1 period (~4ms at 16Mhz) are reported as UINT16_MAX cycles.
+ */
+
+enum latency_site {
+        LATENCY_SITE_FIFO_BUFFER = 0,
+        LATENCY_SITE_CLOCK,
+        LATENCY_SITE_DHTXX_POLL,
+        LATENCY_SITE_UART_RX_ISR,
+        LATENCY_SITE_UART_UDRE_ISR,
+        LATENCY_SITE_CLOCK_ISR,
+        LATENCY_SITE_UART_STATS,
+
+        N_LATENCY_SITES
+};
+
+struct latency_stats {
+        uint16_t worst_cycles;
+        uint8_t worst_site;
+
+        uint16_t site_worst_cycles[N_LATENCY_SITES];
+
+        /* TIMER0 compare match to ISR entry delay, in CPU cycles */
+        uint32_t n_ticks;
+        uint32_t tick_jitter_total;
+        uint16_t tick_jitter_max;
+};
+
+#ifdef LATENCY_ENABLE
+
+/*
+ * NOTE: Window is recorded by cleanup of _latency_window, before ATOMIC_BLOCK restores SREG,
+ *       so "break" and "return" from the block body are measured too
+ */
+#define LATENCY_ATOMIC_BLOCK(site)                                                              \
+        for (uint8_t _latency_sreg = SREG, _latency_once = 1u; _latency_once; _latency_once = 0u) \
+                ATOMIC_BLOCK(ATOMIC_RESTORESTATE)                                               \
+                        for (struct latency_window _latency_window                              \
+                                        __attribute__((__cleanup__(latency_window_leave))) =    \
+                                        { (site), _latency_sreg, latency_enter(_latency_sreg) }, \
+                                *_latency_body = &_latency_window;                              \
+                             _latency_body != NULL; _latency_body = NULL)
+
+#define LATENCY_ISR_BEGIN(site)                                                 \
+        uint16_t _latency_isr_start = latency_enter((uint8_t) _BV(SREG_I))
+
+#define LATENCY_ISR_END(site)                                                   \
+        latency_leave((site), (uint8_t) _BV(SREG_I), _latency_isr_start)
+
+#define LATENCY_TICK(ticks_late, cycles_per_tick)                               \
+        latency_tick((uint8_t) (ticks_late), (cycles_per_tick))
+
+static inline uint16_t latency_enter(uint8_t sreg)
+{
+        /* NOTE: We never enable TOV1 interrupt, so the flag shows that counter has wrapped */
+        if ((sreg & _BV(SREG_I)) != 0u)
+                TIFR1 = (uint8_t) _BV(TOV1);
+
+
+        return hrtimer_now();
+}
+
+void latency_record(enum latency_site site, uint16_t cycles);
+
+static inline void latency_leave(enum latency_site site, uint8_t sreg, uint16_t start)
+{
+        uint16_t cycles = 0u;
+
+
+        if ((sreg & _BV(SREG_I)) == 0u)
+                return;
+
+        cycles = hrtimer_elapsed(start);
+        if ((TIFR1 & _BV(TOV1)) != 0u)
+                cycles = UINT16_MAX;
+
+        latency_record(site, cycles);
+}
+
+struct latency_window {
+        enum latency_site site;
+        uint8_t sreg;
+        uint16_t start;
+};
+
+static inline void latency_window_leave(struct latency_window *window)
+{
+        latency_leave(window->site, window->sreg, window->start);
+}
+
+void latency_setup(void);
+void latency_reset(void);
+void latency_tick(uint8_t timer_ticks_late, uint16_t cycles_per_timer_tick);
+void latency_get_stats(struct latency_stats *stats);
+void latency_dump(void);
+
+#else
+
+#define LATENCY_ATOMIC_BLOCK(site)      ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+#define LATENCY_ISR_BEGIN(site)         do { } while (0)
+#define LATENCY_ISR_END(site)           do { } while (0)
+#define LATENCY_TICK(ticks_late, cycles_per_tick) do { } while (0)
+
+static inline void latency_setup(void) { }
+static inline void latency_reset(void) { }
+static inline void latency_dump(void) { }
+
+#endif /* LATENCY_ENABLE */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* LATENCY_H */
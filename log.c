@@ -0,0 +1,222 @@
+#include <stdarg.h>
+#include <stdbool.h>
+#include <string.h>
+#include <avr/io.h>
+#include <avr/pgmspace.h>
+#include <util/atomic.h>
+
+#include "log.h"
+#include "frame.h"
+#include "clock.h"
+
+static struct uart *log_dev = NULL;
+static struct frame_encoder encoder;
+static bool is_busy = false;
+static unsigned long n_dropped = 0ul;
+
+static uint8_t payload_buf[FRAME_MAX_PAYLOAD_SIZE];
+static uint8_t frame_buf[FRAME_MAX_ENCODED_SIZE];
+
+void log_setup(struct uart *dev)
+{
+        frame_encoder_init(&encoder);
+        log_dev = dev;
+}
+
+unsigned long log_get_dropped(void)
+{
+        unsigned long dropped = 0ul;
+
+
+        ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+                dropped = n_dropped;
+        }
+
+
+        return dropped;
+}
+
+static inline bool put_uint(size_t *offset, unsigned long value, size_t size)
+{
+        size_t i = 0u;
+
+
+        if (*offset + size > sizeof(payload_buf))
+                return false;
+
+        for (; i < size; ++i) {
+                payload_buf[(*offset)++] = (uint8_t) (value & 0xffu);
+                value >>= 8;
+        }
+
+
+        return true;
+}
+
+static inline bool put_string(size_t *offset, const char *str, bool is_progmem)
+{
+        char ch = 0;
+
+
+        /* NOTE: String is truncated to fit the record, but it is always terminated */
+        do {
+                if (*offset >= sizeof(payload_buf))
+                        return false;
+
+                ch = is_progmem ? (char) pgm_read_byte(str) : *str;
+                str++;
+
+                if (*offset + 1u == sizeof(payload_buf))
+                        ch = '\0';
+
+                payload_buf[(*offset)++] = (uint8_t) ch;
+        } while (ch != '\0');
+
+
+        return true;
+}
+
+static bool pack_args(size_t *offset, const char *fmt, va_list ap)
+{
+        char ch = 0;
+        bool is_long = false;
+
+
+        while ((ch = (char) pgm_read_byte(fmt++)) != '\0') {
+                if (ch != '%')
+                        continue;
+
+                is_long = false;
+
+                /* Skip flags, width and precision */
+                while ((ch = (char) pgm_read_byte(fmt++)) != '\0') {
+                        if (ch == '*') {
+                                if (!put_uint(offset, (unsigned) va_arg(ap, int), sizeof(int)))
+                                        return false;
+                        } else if (strchr_P(PSTR("-+ #0123456789."), ch) == NULL)
+                                break;
+                }
+
+                if (ch == 'l') {
+                        is_long = true;
+                        ch = (char) pgm_read_byte(fmt++);
+                }
+
+                switch (ch) {
+                case 'd':
+                case 'i':
+                case 'u':
+                case 'x':
+                case 'X':
+                case 'o':
+                        if (is_long) {
+                                if (!put_uint(offset, va_arg(ap, unsigned long), sizeof(long)))
+                                        return false;
+                        } else if (!put_uint(offset, va_arg(ap, unsigned), sizeof(int)))
+                                return false;
+                        break;
+
+                case 'c':
+                        if (!put_uint(offset, (unsigned) va_arg(ap, int), sizeof(int)))
+                                return false;
+                        break;
+
+                case 's':
+                        if (!put_string(offset, va_arg(ap, const char *), false))
+                                return false;
+                        break;
+
+                case 'S':
+                        if (!put_string(offset, va_arg(ap, const char *), true))
+                                return false;
+                        break;
+
+                case '%':
+                        break;
+
+                default:
+                        /* Unsupported conversion, host can't decode the rest anyway */
+                        return false;
+                }
+        }
+
+
+        return true;
+}
+
+static bool write_frame(size_t size)
+{
+        size_t i = 0u;
+        int flags = 0;
+
+
+        /*
+         * NOTE: With interrupts disabled (ISR, atomic block) TX FIFO never drains, so we
+         *       must not wait for it. Cut frame fails CRC check on host and is skipped.
+         */
+        if ((SREG & _BV(SREG_I)) == 0u)
+                flags = UART_FLAG_NONBLOCK;
+
+        /* Leading delimiter separates the frame from any text sent before it */
+        if (uart_write_byte(log_dev, FRAME_DELIMITER, flags) != UART_RESULT_OK)
+                return false;
+
+        for (; i < size; ++i) {
+                if (uart_write_byte(log_dev, frame_buf[i], flags) != UART_RESULT_OK)
+                        break;
+        }
+
+        log_dev->intr_tx_enable(log_dev->hw);
+
+
+        return i == size;
+}
+
+static bool begin_write(void)
+{
+        bool retval = false;
+
+
+        ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+                if (log_dev != NULL && !is_busy) {
+                        is_busy = true;
+                        retval = true;
+                } else
+                        n_dropped++;
+        }
+
+
+        return retval;
+}
+
+void log_write(const char *fmt, ...)
+{
+        va_list ap;
+        size_t offset = 0u;
+        struct mem_chunk chunk;
+        bool is_packed = false;
+
+
+        /* NOTE: Record is dropped if another one (e.g. from ISR) is being written */
+        if (!begin_write())
+                return;
+
+        put_uint(&offset, (unsigned long) (uintptr_t) fmt, 2u);
+        put_uint(&offset, clock_get_msecs(), 4u);
+
+        va_start(ap, fmt);
+        is_packed = pack_args(&offset, fmt, ap);
+        va_end(ap);
+
+        mem_chunk_set(&chunk, frame_buf, sizeof(frame_buf));
+
+        if (!is_packed || !frame_encode(&encoder, FRAME_TYPE_LOG, payload_buf, offset, &chunk)
+                        || !write_frame(chunk.size)) {
+
+                ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+                        n_dropped++;
+                }
+        }
+
+        is_busy = false;
+}
@@ -0,0 +1,67 @@
+/*
+ * Copyright (c) 2018 Sereda Anton
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ */
+
+#ifndef LOG_H
+#define LOG_H
+
+#include <stdint.h>
+#include <avr/pgmspace.h>
+
+#include "uart.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Deferred-format logging: LOG() emits a FRAME_TYPE_LOG frame with flash address of
+ * the format string, system time in milliseconds and raw argument bytes. Text is
+ * rendered on the host by tools/log-decode, which looks format strings up in firmware ELF.
+ *
+ * Record payload (little-endian):
+ *
+ *      | format address (2) | msecs (4) | arguments ... |
+ *
+ * Supported conversions are the integer ones (with "l" modifier), %c, %s and %S.
+ * Strings are copied into the record NUL-terminated and may be truncated.
+ *
+ * LOG() is safe with interrupts disabled (ISRs, atomic blocks): it never waits for
+ * TX FIFO then, a record that doesn't fit is cut and counted as dropped.
+ */
+
+#define LOG(fmt, ...)                                                                   \
+        do {                                                                            \
+                static char const _log_fmt[]                                            \
+                        __attribute__((section(".progmem.logfmt"), used)) = fmt;        \
+                log_write(_log_fmt, ##__VA_ARGS__);                                     \
+        } while (0)
+
+void log_setup(struct uart *dev);
+void log_write(const char *fmt, ...);
+unsigned long log_get_dropped(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* LOG_H */
@@ -38,37 +38,116 @@
 #include "uart.h"
 #include "panic.h"
 #include "timer.h"
+#include "profile.h"
+#include "latency.h"
+#include "log.h"
+#include "dhtxx.h"
+#include "json-writer.h"
+#include "shell.h"
+#include "mem-monitor.h"
+#include "supervisor.h"
+#include "config.h"
 
-#ifndef UART_DEV_PARAMS
-#define UART_DEV_PARAMS        "UART0:115200@8N1"
-#endif
+static struct gpio dht_port;
+static struct dhtxx dht;
+static struct dhtxx_async dht_async;
+static uint8_t dht_task = SUPERVISOR_INVALID_TASK;
+
+static enum shell_result cmd_dht(struct shell *sh, int argc, char **argv)
+{
+        struct json_writer w;
+        enum dhtxx_result result = DHTXX_RESULT_INCOMPLETE;
+
+
+        if (argc > 1)
+                return SHELL_RESULT_USAGE;
+
+        if (argc == 1) {
+                if (!gpio_is_usable(&dht_port))
+                        return SHELL_RESULT_ERROR;
+
+                dhtxx_async_init(&dht_async);
+                supervisor_arm(dht_task);
+        }
+
+        result = dhtxx_poll_async(&dht, &dht_async);
+        if (result == DHTXX_RESULT_INCOMPLETE)
+                return SHELL_RESULT_PENDING;
+
+        supervisor_disarm(dht_task);
+
+        if (result != DHTXX_RESULT_SUCCESS) {
+                printf_P(PSTR("error %d\n"), (int) result);
+                return SHELL_RESULT_ERROR;
+        }
+
+        json_writer_init_uart(&w, sh->dev);
+        dhtxx_data_json_write(&dht, &w);
+        json_writer_finish(&w);
+
+        printf_P(PSTR("\n"));
+
+
+        return SHELL_RESULT_OK;
+}
+
+static struct shell_cmd const app_commands[] PROGMEM = {
+        { "dht", cmd_dht, "read temperature and humidity" }
+};
 
 
 int main(void)
 {
         struct uart uart;
-        struct timer poll_timer;
+        struct shell shell;
+        struct config *config = NULL;
+        uint8_t shell_task = SUPERVISOR_INVALID_TASK;
 
-        wdt_disable();
         cli();
 
         clock_setup();
-        if (!uart_setup_P(&uart, PSTR(UART_DEV_PARAMS))) {
-                panic();
+        profile_setup();
+        latency_setup();
+
+        /* NOTE: Pre-parsed settings from EEPROM, compiled-in defaults if the block is invalid */
+        config = config_get();
 
+        /* Console must come up, so saved settings it rejects fall back to the defaults */
+        if (!uart_setup_params(&uart, &config->console)
+                        && !uart_setup_P(&uart, PSTR(UART_DEV_PARAMS))) {
+
+                panic_reason(PANIC_REASON_SETUP);
         }
 
         uart_bind_to_cstdin(&uart);
         uart_bind_to_cstdout(&uart);
         uart_bind_to_cstderr(&uart);
+        log_setup(&uart);
+
+        if (gpio_init_params(&dht_port, &config->dht_port))
+                dhtxx_init(&dht, &dht_port);
 
         sei();
 
-        timer_clear(&poll_timer);
-        timer_set_msecs(&poll_timer, 3000u);
+        /* Tell why we were reset and what killed us last time, if anything */
+        panic_report();
+
+        shell_init(&shell, &uart, app_commands, sizeof(app_commands) / sizeof(app_commands[0]));
+
+        /* NOTE: Sensor read is a pending shell command, it is watched only while it runs */
+        dht_task = supervisor_register_P(PSTR("dht"), 500ul);
+        supervisor_disarm(dht_task);
+
+        /* Console service is due on every pass of the main loop */
+        shell_task = supervisor_register_P(PSTR("shell"), 1500ul);
+        supervisor_start();
 
         for (;;) {
+                shell_poll(&shell);
+                supervisor_checkin(shell_task);
 
+                mem_monitor_check();
+                supervisor_poll();
         }
 
 
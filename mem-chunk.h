@@ -25,6 +25,7 @@
 #define MEM_CHUNK_H
 
 #include <stddef.h>
+#include <stdint.h>
 #include <stdbool.h>
 
 #ifdef __cplusplus
@@ -63,6 +64,112 @@ static inline void mem_chunk_set(struct mem_chunk *chunk, void *ptr, size_t size
         chunk->offset = 0u;
 }
 
+/*
+ * NOTE: Chain is an array of chunks transferred as one stream. Chunks keep their own
+ *       offsets and "index" points to the first unfinished one, so transfers resume.
+ */
+struct mem_chain {
+        struct mem_chunk *chunks;
+
+        size_t n_chunks;
+        size_t index;
+};
+
+#define MEM_CHAIN_FOREACH(chain, chunk)                                                 \
+        for ((chunk) = (chain)->chunks; (chunk) < &(chain)->chunks[(chain)->n_chunks]; ++(chunk))
+
+static inline void mem_chain_init(struct mem_chain *chain, struct mem_chunk *chunks, size_t n_chunks)
+{
+        chain->chunks = chunks;
+        chain->n_chunks = n_chunks;
+        chain->index = 0u;
+}
+
+static inline void mem_chain_rewind(struct mem_chain *chain)
+{
+        struct mem_chunk *chunk = NULL;
+
+
+        MEM_CHAIN_FOREACH(chain, chunk)
+                chunk->offset = 0u;
+
+        chain->index = 0u;
+}
+
+static inline size_t mem_chain_get_size(const struct mem_chain *chain)
+{
+        const struct mem_chunk *chunk = NULL;
+        size_t size = 0u;
+
+
+        MEM_CHAIN_FOREACH(chain, chunk)
+                size += chunk->size;
+
+
+        return size;
+}
+
+static inline size_t mem_chain_get_remaining(const struct mem_chain *chain)
+{
+        size_t i = 0u;
+        size_t size = 0u;
+
+
+        for (i = chain->index; i < chain->n_chunks; ++i)
+                size += chain->chunks[i].size - chain->chunks[i].offset;
+
+
+        return size;
+}
+
+static inline bool mem_chain_is_completed(const struct mem_chain *chain)
+{
+        return mem_chain_get_remaining(chain) == 0u;
+}
+
+/*
+ * NOTE: Slice refers to the same memory as "base", it needs its own array of chunks
+ *       because first and last pieces are cut.
+ */
+static inline bool mem_chain_slice(const struct mem_chain *base, size_t offset, size_t size,
+                                   struct mem_chain *slice, struct mem_chunk *chunks, size_t max_chunks)
+{
+        const struct mem_chunk *chunk = NULL;
+        size_t n_chunks = 0u;
+        size_t piece = 0u;
+
+
+        MEM_CHAIN_FOREACH(base, chunk) {
+                if (size == 0u)
+                        break;
+
+                if (offset >= chunk->size) {
+                        offset -= chunk->size;
+                        continue;
+                }
+
+                if (n_chunks == max_chunks)
+                        return false;
+
+                piece = chunk->size - offset;
+                if (piece > size)
+                        piece = size;
+
+                mem_chunk_set(&chunks[n_chunks++], &((uint8_t *) chunk->ptr)[offset], piece);
+
+                size -= piece;
+                offset = 0u;
+        }
+
+        if (size != 0u)
+                return false;   /* Slice is out of chain bounds */
+
+        mem_chain_init(slice, chunks, n_chunks);
+
+
+        return true;
+}
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,124 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <avr/io.h>
+#include <avr/pgmspace.h>
+
+#include "mem-monitor.h"
+#include "panic.h"
+
+/* Symbols from the default linker script */
+extern uint8_t __data_start;
+extern uint8_t __data_end;
+extern uint8_t __bss_start;
+extern uint8_t __bss_end;
+extern uint8_t __noinit_start;
+extern uint8_t __noinit_end;
+extern uint8_t __heap_start;
+
+/* NOTE: Weak, so we don't link malloc() just to learn that nobody uses it */
+extern uint8_t *__brkval __attribute__((weak));
+
+static uint8_t *watermark = NULL;
+
+void mem_monitor_paint(void) __attribute__((naked, used, section(".init1")));
+
+void mem_monitor_paint(void)
+{
+        /*
+         * NOTE: Runs before the stack pointer and r1 are set up, so no C here.
+         *       Everything from the heap start to the top of SRAM gets painted.
+         */
+        __asm__ __volatile__ (
+                "       ldi r30, lo8(__heap_start)      \n"
+                "       ldi r31, hi8(__heap_start)      \n"
+                "       ldi r24, %0                     \n"
+                "       ldi r25, hi8(__stack)           \n"
+                "       rjmp 2f                         \n"
+                "1:     st Z+, r24                      \n"
+                "2:     cpi r30, lo8(__stack)           \n"
+                "       cpc r31, r25                    \n"
+                "       brlo 1b                         \n"
+                "       breq 1b                         \n"
+                :
+                : "M" (MEM_MONITOR_CANARY)
+        );
+}
+
+static inline uint8_t *get_heap_end(void)
+{
+        if (&__brkval != NULL && __brkval != NULL)
+                return __brkval;
+
+
+        return &__heap_start;
+}
+
+size_t mem_monitor_update(void)
+{
+        uint8_t *heap_end = NULL;
+        uint8_t *p = NULL;
+
+
+        heap_end = get_heap_end();
+
+        /*
+         * NOTE: Always a full scan from the heap end up. Frames with partly written buffers
+         *       leave canary holes, so walking down from the old mark can stop short of
+         *       a deeper excursion.
+         */
+        p = heap_end;
+        while (p <= (uint8_t *) RAMEND && *p == MEM_MONITOR_CANARY)
+                p++;
+
+        if (watermark == NULL || p < watermark)
+                watermark = p;
+
+
+        return (size_t) ((watermark > heap_end) ? watermark - heap_end : 0);
+}
+
+void mem_monitor_check(void)
+{
+        uint8_t *heap_end = NULL;
+        size_t i = 0u;
+
+
+        /* NOTE: Called from the main loop, so only the red zone is checked, not the whole gap */
+        heap_end = get_heap_end();
+
+        for (; i < (size_t) MEM_MONITOR_RED_ZONE; ++i) {
+                if (heap_end + i > (uint8_t *) RAMEND || heap_end[i] != MEM_MONITOR_CANARY)
+                        panic_reason(PANIC_REASON_STACK_OVERFLOW);
+        }
+}
+
+void mem_monitor_get_stats(struct mem_monitor_stats *stats)
+{
+        uint8_t *heap_end = NULL;
+
+
+        stats->free_margin = mem_monitor_update();
+
+        heap_end = get_heap_end();
+
+        stats->data_size = (size_t) (&__data_end - &__data_start);
+        stats->bss_size = (size_t) (&__bss_end - &__bss_start);
+        stats->noinit_size = (size_t) (&__noinit_end - &__noinit_start);
+        stats->heap_size = (size_t) (heap_end - &__heap_start);
+
+        stats->stack_size = (size_t) (RAMEND - SP);
+        stats->stack_max = (size_t) ((uint8_t *) RAMEND + 1 - watermark);
+}
+
+void mem_monitor_dump(void)
+{
+        struct mem_monitor_stats s;
+
+
+        mem_monitor_get_stats(&s);
+
+        printf_P(PSTR("// sram: data %u bss %u noinit %u heap %u stack %u max %u free %u\n"),
+                 (unsigned) s.data_size, (unsigned) s.bss_size, (unsigned) s.noinit_size,
+                 (unsigned) s.heap_size, (unsigned) s.stack_size, (unsigned) s.stack_max,
+                 (unsigned) s.free_margin);
+}
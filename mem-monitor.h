@@ -0,0 +1,66 @@
+/*
+ * Copyright (c) 2018 Sereda Anton
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ */
+
+#ifndef MEM_MONITOR_H
+#define MEM_MONITOR_H
+
+#include <stddef.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * NOTE: Free SRAM between the heap and the stack is painted with MEM_MONITOR_CANARY
+ *       before .data and .bss are initialized. Stack high-water mark is the lowest
+ *       painted byte that got overwritten.
+ */
+#define MEM_MONITOR_CANARY 0xc5
+
+/* Minimal margin between the heap and the stack high-water mark before we panic */
+#ifndef MEM_MONITOR_RED_ZONE
+#define MEM_MONITOR_RED_ZONE 64
+#endif
+
+struct mem_monitor_stats {
+        size_t data_size;
+        size_t bss_size;
+        size_t noinit_size;
+        size_t heap_size;
+
+        size_t stack_size;
+        size_t stack_max;
+        size_t free_margin;
+};
+
+size_t mem_monitor_update(void);
+void mem_monitor_check(void);
+void mem_monitor_get_stats(struct mem_monitor_stats *stats);
+void mem_monitor_dump(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* MEM_MONITOR_H */
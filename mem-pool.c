@@ -0,0 +1,102 @@
+#include <string.h>
+#include <util/atomic.h>
+
+#include "mem-pool.h"
+
+MEM_ARENA_DEFINE(mem_scratch, MEM_SCRATCH_SIZE);
+
+void *mem_pool_alloc(struct mem_pool *pool)
+{
+        void *block = NULL;
+
+
+        ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+                if (pool->free_list != NULL) {
+                        block = pool->free_list;
+                        pool->free_list = *(void **) block;
+                } else if (pool->n_fresh < pool->n_blocks) {
+                        block = &pool->storage[pool->n_fresh * pool->block_size];
+                        pool->n_fresh++;
+                }
+
+                if (block != NULL) {
+                        pool->n_used++;
+
+                        if (pool->n_used > pool->max_used)
+                                pool->max_used = pool->n_used;
+                } else
+                        pool->n_failures++;
+        }
+
+
+        return block;
+}
+
+void mem_pool_free(struct mem_pool *pool, void *block)
+{
+        if (block == NULL)
+                return;
+
+        ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+                *(void **) block = pool->free_list;
+                pool->free_list = block;
+                pool->n_used--;
+        }
+}
+
+void mem_pool_get_stats(struct mem_pool *pool, struct mem_pool_stats *stats)
+{
+        ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+                stats->block_size = pool->block_size;
+                stats->n_blocks = pool->n_blocks;
+                stats->n_used = pool->n_used;
+                stats->max_used = pool->max_used;
+                stats->n_failures = pool->n_failures;
+        }
+}
+
+void mem_arena_init(struct mem_arena *arena, void *buf, size_t size)
+{
+        memset(arena, 0, sizeof(struct mem_arena));
+
+        arena->buf = (uint8_t *) buf;
+        arena->size = size;
+}
+
+void *mem_arena_alloc(struct mem_arena *arena, size_t size)
+{
+        void *ptr = NULL;
+
+
+        size = MEM_ALIGN_SIZE(size);
+
+        if (size > arena->size - arena->used) {
+                arena->n_failures++;
+                return NULL;
+        }
+
+        ptr = &arena->buf[arena->used];
+        arena->used += size;
+
+        if (arena->used > arena->max_used)
+                arena->max_used = arena->used;
+
+
+        return ptr;
+}
+
+size_t mem_arena_get_mark(struct mem_arena *arena)
+{
+        return arena->used;
+}
+
+void mem_arena_release(struct mem_arena *arena, size_t mark)
+{
+        if (mark < arena->used)
+                arena->used = mark;
+}
+
+void mem_arena_reset(struct mem_arena *arena)
+{
+        arena->used = 0u;
+}
@@ -0,0 +1,115 @@
+/*
+ * Copyright (c) 2018 Sereda Anton
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ */
+
+#ifndef MEM_POOL_H
+#define MEM_POOL_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* NOTE: Alignment of pool blocks and arena allocations, it is 1 on AVR */
+#ifndef MEM_ALIGN
+#define MEM_ALIGN __BIGGEST_ALIGNMENT__
+#endif
+
+#define MEM_ALIGN_SIZE(size) ((((size_t) (size)) + MEM_ALIGN - 1u) / MEM_ALIGN * MEM_ALIGN)
+
+/* Block must be able to hold a free list link */
+#define MEM_POOL_BLOCK_SIZE(size) \
+        MEM_ALIGN_SIZE((size_t) (size) < sizeof(void *) ? sizeof(void *) : (size_t) (size))
+
+/*
+ * NOTE: Fixed-size block pool. Blocks are taken from the never used tail first and from
+ *       the free list after that, so both alloc and free are O(1) and pool needs no
+ *       initialization at run-time. Both are safe to call from ISR.
+ */
+struct mem_pool {
+        uint8_t *storage;
+        size_t block_size;
+        uint8_t n_blocks;
+        uint8_t n_fresh;
+
+        void *free_list;
+
+        uint8_t n_used;
+        uint8_t max_used;
+        uint16_t n_failures;
+};
+
+struct mem_pool_stats {
+        size_t block_size;
+        uint8_t n_blocks;
+        uint8_t n_used;
+        uint8_t max_used;
+        uint16_t n_failures;
+};
+
+#define MEM_POOL_DEFINE(name, block_size, n_blocks)                                             \
+        static uint8_t name##_storage[MEM_POOL_BLOCK_SIZE(block_size) * (n_blocks)]             \
+                __attribute__((aligned(MEM_ALIGN)));                                            \
+        struct mem_pool name = {                                                                \
+                name##_storage, MEM_POOL_BLOCK_SIZE(block_size), (n_blocks), 0u, NULL, 0u, 0u, 0u \
+        }
+
+/*
+ * NOTE: Bump allocator for per-transaction scratch space. Memory is given back all at
+ *       once by mem_arena_reset() or down to a mark. Not for use from ISR.
+ */
+struct mem_arena {
+        uint8_t *buf;
+        size_t size;
+        size_t used;
+        size_t max_used;
+        uint16_t n_failures;
+};
+
+#define MEM_ARENA_DEFINE(name, size)                                                            \
+        static uint8_t name##_buf[MEM_ALIGN_SIZE(size)] __attribute__((aligned(MEM_ALIGN)));    \
+        struct mem_arena name = { name##_buf, MEM_ALIGN_SIZE(size), 0u, 0u, 0u }
+
+/* Shared scratch arena for parsing configuration strings and similar short-lived data */
+#ifndef MEM_SCRATCH_SIZE
+#define MEM_SCRATCH_SIZE 64
+#endif
+
+extern struct mem_arena mem_scratch;
+
+void *mem_pool_alloc(struct mem_pool *pool);
+void mem_pool_free(struct mem_pool *pool, void *block);
+void mem_pool_get_stats(struct mem_pool *pool, struct mem_pool_stats *stats);
+void mem_arena_init(struct mem_arena *arena, void *buf, size_t size);
+void *mem_arena_alloc(struct mem_arena *arena, size_t size);
+size_t mem_arena_get_mark(struct mem_arena *arena);
+void mem_arena_release(struct mem_arena *arena, size_t mark);
+void mem_arena_reset(struct mem_arena *arena);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* MEM_POOL_H */
@@ -3,6 +3,11 @@
 #include <avr/pgmspace.h>
 
 #include "modbus-rtu.h"
+#include "config.h"
+#include "crc16.h"
+#include "mem-pool.h"
+#include "log.h"
+#include "profile.h"
 
 enum {
         ASYNC_RECV_INIT,
@@ -15,11 +20,11 @@ enum {
 #define UINT16_HI(u16)  ((((uint16_t) (u16)) >> 8) & 0xff)
 #define UINT16_LOW(u16) (((uint16_t) (u16)) & 0xff)
 
-/* Initial value of CRC16 register from MODBUS RTU standart */
-#define CRC16_REG_INITIALIZER 0xffffu
-
 #define TMP_SIZE 60
 
+/* Receive state of in-flight transactions, response buffer included */
+MEM_POOL_DEFINE(modbus_async_pool, sizeof(struct modbus_rtu_async), MODBUS_RTU_MAX_TRANSACTIONS);
+
 void modbus_req_clear(struct modbus_req *req)
 {
         memset(req, 0, sizeof(struct modbus_req));
@@ -39,6 +44,35 @@ bool modbus_resp_is_exception(struct modbus_resp *resp)
         return (resp->func_code & 0x80) != 0u;
 }
 
+void modbus_resp_json_write(struct modbus_resp *resp, struct json_writer *w)
+{
+        size_t i = 0u;
+
+
+        json_writer_begin_object(w);
+
+        json_writer_key_P(w, PSTR("slave"));
+        json_writer_uint(w, resp->slave_addr);
+        json_writer_key_P(w, PSTR("func"));
+        json_writer_uint(w, resp->func_code);
+
+        if (modbus_resp_is_exception(resp)) {
+                json_writer_key_P(w, PSTR("exception"));
+                json_writer_uint(w, resp->except_code);
+
+        } else {
+                json_writer_key_P(w, PSTR("data"));
+                json_writer_begin_array(w);
+
+                for (; i < resp->data_size && i < (size_t) MODBUS_RESP_DATA_SIZE; ++i)
+                        json_writer_uint(w, resp->data[i]);
+
+                json_writer_end_array(w);
+        }
+
+        json_writer_end_object(w);
+}
+
 static bool async_recv_impl(struct modbus_rtu *rtu, struct modbus_rtu_async *async)
 {
         enum uart_result res = 0;
@@ -73,21 +107,39 @@ bool modbus_rtu_async_is_completed(struct modbus_rtu_async *async)
         return async->state == ASYNC_RECV_COMPLETED;
 }
 
-static inline bool setup_impl(struct modbus_rtu *rtu, char *params)
+struct modbus_rtu_async *modbus_rtu_async_alloc(void)
+{
+        struct modbus_rtu_async *async = NULL;
+
+
+        if ((async = (struct modbus_rtu_async *) mem_pool_alloc(&modbus_async_pool)) != NULL)
+                modbus_rtu_async_init(async);
+
+
+        return async;
+}
+
+void modbus_rtu_async_free(struct modbus_rtu_async *async)
+{
+        mem_pool_free(&modbus_async_pool, async);
+}
+
+struct mem_pool *modbus_rtu_get_async_pool(void)
+{
+        return &modbus_async_pool;
+}
+
+static inline bool parse_impl(struct modbus_rtu_params *params, char *str)
 {
-        struct uart *uart = NULL;
-        struct gpio *enable_port = NULL;
         char *save_ptr = NULL;
         char *s = NULL;
         char *token = NULL;
         char *param_value = NULL;
 
 
-        uart = &rtu->uart;
-        enable_port = &rtu->enable_port;
+        memset(params, 0, sizeof(struct modbus_rtu_params));
 
-
-        s = params;
+        s = str;
         while ((token = strtok_r(s, ",", &save_ptr)) != NULL) {
                 s = NULL;
 
@@ -97,10 +149,10 @@ static inline bool setup_impl(struct modbus_rtu *rtu, char *params)
 
 
                 if (strstr_P(token, PSTR("uart=")) != NULL) {
-                        if (!uart_setup(uart, param_value))
+                        if (!uart_parse_params(&params->uart, param_value))
                                 return false;
                 } else if (strstr_P(token, PSTR("de_port=")) != NULL) {
-                        if (!gpio_init(enable_port, param_value))
+                        if (!gpio_parse_params(&params->de_port, param_value))
                                 return false;
                 } else
                         return false;
@@ -108,81 +160,114 @@ static inline bool setup_impl(struct modbus_rtu *rtu, char *params)
         }
 
 
-        return true;
+        /* NOTE: UART is mandatory, boards without a spare one pass empty parameters */
+        return params->uart.baud_rate != 0u;
 }
 
-bool modbus_rtu_setup(struct modbus_rtu *rtu, const char *params)
+static bool parse_copy(struct modbus_rtu_params *params, const char *str, bool is_progmem)
 {
-        char tmp[TMP_SIZE] = {0, };
+        size_t mark = 0u;
+        char *tmp = NULL;
+        bool retval = false;
+
+
+        /* NOTE: Parameters are tokenized in place, so we parse a copy in scratch arena */
+        mark = mem_arena_get_mark(&mem_scratch);
 
-        strncpy(tmp, params, TMP_SIZE - 1);
-        return setup_impl(rtu, tmp);
+        if ((tmp = (char *) mem_arena_alloc(&mem_scratch, TMP_SIZE)) != NULL) {
+                if (is_progmem)
+                        strncpy_P(tmp, str, TMP_SIZE - 1);
+                else
+                        strncpy(tmp, str, TMP_SIZE - 1);
+
+                tmp[TMP_SIZE - 1] = '\0';
+                retval = parse_impl(params, tmp);
+        }
+
+        mem_arena_release(&mem_scratch, mark);
+
+
+        return retval;
 }
 
-bool modbus_rtu_setup_P(struct modbus_rtu *rtu, const char *params)
+bool modbus_rtu_parse_params(struct modbus_rtu_params *params, const char *str)
 {
-        char tmp[TMP_SIZE] = {0, };
+        return parse_copy(params, str, false);
+}
 
-        strncpy_P(tmp, params, TMP_SIZE - 1);
-        return setup_impl(rtu, tmp);
+bool modbus_rtu_parse_params_P(struct modbus_rtu_params *params, const char *str)
+{
+        return parse_copy(params, str, true);
 }
 
-struct modbus_rtu *modbus_rtu_get_instance(void)
+bool modbus_rtu_setup_params(struct modbus_rtu *rtu, const struct modbus_rtu_params *params)
 {
-        static struct modbus_rtu rtu;
-        static struct modbus_rtu *instance = NULL;
+        memset(rtu, 0, sizeof(struct modbus_rtu));
 
+        /* NOTE: Console UART is never taken over, its setup would cut off the shell */
+        if (params->uart.dev_num == config_get()->console.dev_num)
+                return false;
 
-        if (instance == NULL) {
-                if (modbus_rtu_setup_P(&rtu, PSTR(MODBUS_RTU_PARAMS))) {
-                        instance = &rtu;
+        if (!uart_setup_params(&rtu->uart, &params->uart))
+                return false;
 
-                } else {
-                        /* FIXME: Log about BUG here! */
-                        printf_P(PSTR("// Failed to configure ModBus RTU subsystem.\n"));
-                }
+        /* NOTE: DE line is optional, port letter is zero when it is not configured */
+        if (params->de_port.port_letter != '\0'
+                        && !gpio_init_params(&rtu->enable_port, &params->de_port)) {
+
+                return false;
         }
 
 
-        return instance;
+        return true;
 }
 
-static inline void crc16_byte(uint16_t *crc_reg, uint8_t byte)
+bool modbus_rtu_setup(struct modbus_rtu *rtu, const char *params)
 {
-        size_t i = 0u;
+        struct modbus_rtu_params parsed;
 
 
-        *crc_reg ^= byte;
+        memset(rtu, 0, sizeof(struct modbus_rtu));
 
-        for (; i < 8u; ++i) {
-                if ((*crc_reg & 1u) != 0u) {
-                        *crc_reg >>= 1;
-                        *crc_reg ^= 0xa001u;
-                } else
-                        *crc_reg >>= 1;
-        }
+        if (!modbus_rtu_parse_params(&parsed, params))
+                return false;
+
+
+        return modbus_rtu_setup_params(rtu, &parsed);
 }
 
-static inline void req_calc_crc(struct modbus_req *req)
+bool modbus_rtu_setup_P(struct modbus_rtu *rtu, const char *params)
 {
-        size_t i = 0u;
-        const uint8_t *bytes = NULL;
-        uint16_t crc_reg = CRC16_REG_INITIALIZER;
+        struct modbus_rtu_params parsed;
+
+
+        memset(rtu, 0, sizeof(struct modbus_rtu));
+
+        if (!modbus_rtu_parse_params_P(&parsed, params))
+                return false;
 
 
-        crc16_byte(&crc_reg, req->slave_addr);
-        crc16_byte(&crc_reg, req->func_code);
+        return modbus_rtu_setup_params(rtu, &parsed);
+}
+
+struct modbus_rtu *modbus_rtu_get_instance(void)
+{
+        static struct modbus_rtu rtu;
+        static struct modbus_rtu *instance = NULL;
+
 
-        if (req->data != NULL) {
-                bytes = (const uint8_t *) req->data;
-                for (; i < req->data_size; ++i)
-                        crc16_byte(&crc_reg, bytes[i]);
+        if (instance == NULL) {
+                /* NOTE: Settings come pre-parsed from EEPROM or from MODBUS_RTU_PARAMS */
+                if (modbus_rtu_setup_params(&rtu, &config_get()->modbus)) {
+                        instance = &rtu;
+
+                } else
+                        LOG("Failed to configure ModBus RTU subsystem, config source %u",
+                            (unsigned) config_get_source());
         }
 
-        crc16_byte(&crc_reg, UINT16_HI(req->quantity));
-        crc16_byte(&crc_reg, UINT16_LOW(req->quantity));
 
-        req->crc = crc_reg;
+        return instance;
 }
 
 static inline void set_driver_enable(struct modbus_rtu *rtu, bool enable)
@@ -192,43 +277,91 @@ static inline void set_driver_enable(struct modbus_rtu *rtu, bool enable)
          *       so we set line HIGH by changing direction to input
          */
 
+#ifdef MODBUS_RTU_DE_PIN
+        if (enable) {
+                GPIO_PIN_INPUT(MODBUS_RTU_DE_PIN);
+        } else {
+                GPIO_PIN_LOW(MODBUS_RTU_DE_PIN);
+                GPIO_PIN_OUTPUT(MODBUS_RTU_DE_PIN);
+        }
+#else
+        /* NOTE: DE line is optional, e.g. for RS-232 or auto-direction transceivers */
+        if (!gpio_is_usable(&rtu->enable_port))
+                return;
+
         if (enable)
                 gpio_set_direction(&rtu->enable_port, GPIO_DIRECTION_INPUT);
         else
                 gpio_write(&rtu->enable_port, GPIO_STATE_LOW);
+#endif
 }
 
-static inline void send_byte(struct modbus_rtu *rtu, uint8_t byte)
+static void send_impl(struct modbus_rtu *rtu, struct modbus_req *req, bool is_async)
 {
-        uart_write_byte(&rtu->uart, byte, UART_FLAG_SYNC_TXC);
-}
+        uint8_t header[2];
+        uint8_t quantity[2];
+        uint8_t crc[2];
+        struct mem_chunk chunks[4];
+        struct mem_chain chain;
+        uint16_t crc_reg = CRC16_REG_INITIALIZER;
 
-static inline void send(struct modbus_rtu *rtu, const uint8_t *data, size_t size)
-{
-        struct mem_chunk chunk;
 
+        header[0] = req->slave_addr;
+        header[1] = req->func_code;
+
+        quantity[0] = (uint8_t) UINT16_HI(req->quantity);
+        quantity[1] = (uint8_t) UINT16_LOW(req->quantity);
 
-        if (data != NULL) {
-                mem_chunk_set(&chunk, (void *) data, size);
-                uart_write_chunk(&rtu->uart, &chunk, UART_FLAG_SYNC_TXC);
+        /* NOTE: Request is sent straight from its parts, without assembling a frame */
+        mem_chunk_set(&chunks[0], header, sizeof(header));
+        mem_chunk_set(&chunks[1], (void *) req->data, req->data != NULL ? req->data_size : 0u);
+        mem_chunk_set(&chunks[2], quantity, sizeof(quantity));
+        mem_chunk_set(&chunks[3], crc, sizeof(crc));
+
+        mem_chain_init(&chain, chunks, 3u);
+        crc16_update_chain(&crc_reg, &chain);
+
+        req->crc = crc_reg;
+        crc[0] = (uint8_t) UINT16_LOW(req->crc);
+        crc[1] = (uint8_t) UINT16_HI(req->crc);
+
+        mem_chain_init(&chain, chunks, 4u);
+
+        set_driver_enable(rtu, true);
+
+        if (!is_async) {
+                uart_write_chain(&rtu->uart, &chain, UART_FLAG_SYNC_TXC);
+                set_driver_enable(rtu, false);
+                return;
         }
+
+        uart_clear_tx_complete(&rtu->uart);
+
+        /* NOTE: Request longer than TX FIFO waits for the FIFO to take the rest of it */
+        if (uart_write_chain(&rtu->uart, &chain, UART_FLAG_NONBLOCK) != UART_RESULT_OK)
+                uart_write_chain(&rtu->uart, &chain, 0);
 }
 
 void modbus_rtu_send_sync(struct modbus_rtu *rtu, struct modbus_req *req)
 {
-        req_calc_crc(req);
+        send_impl(rtu, req, false);
+}
 
-        set_driver_enable(rtu, true);
+void modbus_rtu_send_async(struct modbus_rtu *rtu, struct modbus_req *req)
+{
+        send_impl(rtu, req, true);
+}
 
-        send_byte(rtu, req->slave_addr);
-        send_byte(rtu, req->func_code);
-        send(rtu, req->data, req->data_size);
-        send_byte(rtu, UINT16_HI(req->quantity));
-        send_byte(rtu, UINT16_LOW(req->quantity));
-        send_byte(rtu, UINT16_LOW(req->crc));
-        send_byte(rtu, UINT16_HI(req->crc));
+bool modbus_rtu_send_is_completed(struct modbus_rtu *rtu)
+{
+        /* NOTE: DE line is released only after the last stop bit has left the wire */
+        if (!uart_is_tx_complete(&rtu->uart))
+                return false;
 
         set_driver_enable(rtu, false);
+
+
+        return true;
 }
 
 static inline void recv_byte(struct modbus_rtu *rtu, uint8_t *ptr)
@@ -375,7 +508,8 @@ static inline enum modbus_result recv_async_crc(struct modbus_rtu_async *async)
         return async_recv_complete(async, MODBUS_RESULT_CRC_ERROR);
 }
 
-enum modbus_result modbus_rtu_recv_async(struct modbus_rtu *rtu, struct modbus_rtu_async *async)
+static inline enum modbus_result recv_async_impl(struct modbus_rtu *rtu,
+                                                 struct modbus_rtu_async *async)
 {
         if (modbus_rtu_async_is_completed(async))
                 return async->result;
@@ -393,3 +527,18 @@ enum modbus_result modbus_rtu_recv_async(struct modbus_rtu *rtu, struct modbus_r
 
         return async->result;
 }
+
+enum modbus_result modbus_rtu_recv_async(struct modbus_rtu *rtu, struct modbus_rtu_async *async)
+{
+        enum modbus_result result = MODBUS_RESULT_INCOMPLETE;
+
+
+        PROFILE_BEGIN(PROFILE_REGION_MODBUS_RECV_ASYNC);
+
+        result = recv_async_impl(rtu, async);
+
+        PROFILE_END(PROFILE_REGION_MODBUS_RECV_ASYNC);
+
+
+        return result;
+}
@@ -24,17 +24,25 @@
 #ifndef MODBUS_RTU_H
 #define MODBUS_RTU_H
 
+#include "board.h"
 #include "gpio.h"
 #include "uart.h"
+#include "json-writer.h"
+#include "mem-pool.h"
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
 #ifndef MODBUS_RTU_PARAMS
-#define MODBUS_RTU_PARAMS "uart=UART1:9600@8N1,de_port=PORTL:0"
+#define MODBUS_RTU_PARAMS BOARD_MODBUS_RTU_PARAMS
 #endif
 
+/*
+ * NOTE: Define MODBUS_RTU_DE_PIN as GPIO_PIN(L, 0) to drive the DE line directly through
+ *       I/O registers, "de_port" parameter is ignored in this case.
+ */
+
 /* Modbus functions: */
 #define MODBUS_FUNC_READ_COILS                  0x01
 #define MODBUS_FUNC_READ_DISCRETE_INPUTS        0x02
@@ -58,6 +66,11 @@ extern "C" {
 
 #define MODBUS_RESP_DATA_SIZE 32
 
+/* NOTE: Number of receive states modbus_rtu_async_alloc() can hand out at once */
+#ifndef MODBUS_RTU_MAX_TRANSACTIONS
+#define MODBUS_RTU_MAX_TRANSACTIONS 2
+#endif
+
 enum modbus_result {
         MODBUS_RESULT_OK = 0,
         MODBUS_RESULT_INCOMPLETE,
@@ -87,6 +100,12 @@ struct modbus_resp {
         uint16_t crc;
 };
 
+/* NOTE: Pre-parsed MODBUS_RTU_PARAMS, as kept in EEPROM config */
+struct modbus_rtu_params {
+        struct uart_params uart;
+        struct gpio_params de_port;
+};
+
 struct modbus_rtu {
         struct uart uart;
         struct gpio enable_port;
@@ -107,12 +126,21 @@ struct modbus_rtu_async {
 void modbus_req_clear(struct modbus_req *req);
 void modbus_resp_clear(struct modbus_resp *resp);
 bool modbus_resp_is_exception(struct modbus_resp *resp);
+void modbus_resp_json_write(struct modbus_resp *resp, struct json_writer *w);
 void modbus_rtu_async_init(struct modbus_rtu_async *async);
 bool modbus_rtu_async_is_completed(struct modbus_rtu_async *async);
+struct modbus_rtu_async *modbus_rtu_async_alloc(void);
+void modbus_rtu_async_free(struct modbus_rtu_async *async);
+struct mem_pool *modbus_rtu_get_async_pool(void);
 struct modbus_rtu *modbus_rtu_get_instance(void);
+bool modbus_rtu_parse_params(struct modbus_rtu_params *params, const char *str);
+bool modbus_rtu_parse_params_P(struct modbus_rtu_params *params, const char *str);
+bool modbus_rtu_setup_params(struct modbus_rtu *rtu, const struct modbus_rtu_params *params);
 bool modbus_rtu_setup(struct modbus_rtu *rtu, const char *params);
 bool modbus_rtu_setup_P(struct modbus_rtu *rtu, const char *params);
 void modbus_rtu_send_sync(struct modbus_rtu *rtu, struct modbus_req *req);
+void modbus_rtu_send_async(struct modbus_rtu *rtu, struct modbus_req *req);
+bool modbus_rtu_send_is_completed(struct modbus_rtu *rtu);
 enum modbus_result modbus_rtu_recv_sync(struct modbus_rtu *rtu, struct modbus_resp *resp);
 enum modbus_result modbus_rtu_recv_async(struct modbus_rtu *rtu, struct modbus_rtu_async *async);
 
@@ -1,48 +1,173 @@
+#include <stdio.h>
+#include <string.h>
 #include <avr/io.h>
 #include <avr/pgmspace.h>
 #include <avr/wdt.h>
 #include <avr/interrupt.h>
 #include <util/delay.h>
 
+#include "board.h"
 #include "gpio.h"
+#include "clock.h"
+#include "crc16.h"
+#include "log.h"
+#include "gpio-intr.h"
+#include "mem-monitor.h"
 #include "panic.h"
 
-static inline void disable_all_gpio_ports(void)
+#ifndef PANIC_LED_PIN
+#define PANIC_LED_PIN BOARD_LED_PIN
+#endif
+
+#define PANIC_RECORD_MAGIC 0xdead
+
+static struct panic_record record __attribute__((section(".noinit")));
+static uint8_t reset_flags __attribute__((section(".noinit")));
+
+void panic_save_reset_flags(void) __attribute__((naked, used, section(".init3")));
+
+void panic_save_reset_flags(void)
 {
-        DDRA = (uint8_t) 0u;
-        DDRB = (uint8_t) 0u;
-        DDRC = (uint8_t) 0u;
-        DDRD = (uint8_t) 0u;
-        DDRE = (uint8_t) 0u;
-        DDRF = (uint8_t) 0u;
-        DDRG = (uint8_t) 0u;
-        DDRH = (uint8_t) 0u;
-        DDRJ = (uint8_t) 0u;
-        DDRK = (uint8_t) 0u;
-        DDRL = (uint8_t) 0u;
+        /*
+         * NOTE: Watchdog stays enabled after watchdog reset with the shortest timeout,
+         *       so it must be stopped before .data and .bss initialization.
+         */
+        reset_flags = MCUSR;
+        MCUSR = (uint8_t) 0u;
+        wdt_disable();
 }
 
-void panic(void)
+static inline uint16_t record_crc(struct panic_record *r)
 {
-        struct gpio led_port;
-        enum gpio_state led_state = GPIO_STATE_HIGH;
+        uint16_t crc_reg = CRC16_REG_INITIALIZER;
 
 
-        wdt_disable();
+        crc16_update(&crc_reg, r, offsetof(struct panic_record, crc));
+
+
+        return crc_reg;
+}
+
+static inline uint16_t saturate_u16(unsigned long value)
+{
+        return value > 0xfffful ? (uint16_t) 0xffffu : (uint16_t) value;
+}
+
+#define DISABLE_GPIO_PORT(letter, port) DDR##port = (uint8_t) 0u;
+
+static inline void disable_all_gpio_ports(void)
+{
+        BOARD_GPIO_PORT_LIST(DISABLE_GPIO_PORT)
+}
+
+static void __attribute__((noreturn)) crash(enum panic_reason reason, const char *detail,
+                                            void *return_addr)
+{
         cli();
 
-        disable_all_gpio_ports();
+        memset(record.detail, 0, sizeof(record.detail));
+        if (detail != NULL)
+                strncpy_P(record.detail, detail, sizeof(record.detail) - 1);
 
-        gpio_init_P(&led_port, PSTR("PORTB:7"));
+        record.magic = PANIC_RECORD_MAGIC;
+        record.reason = (uint8_t) reason;
+        record.return_addr = (uint16_t) (uintptr_t) return_addr;
+        record.sp = (uint16_t) SP;
+        record.uptime_msecs = clock_get_msecs();
 
-        for (;;) {
-                gpio_write(&led_port, led_state);
+        record.stack_free = saturate_u16(mem_monitor_update());
+        record.n_log_dropped = saturate_u16(log_get_dropped());
+        record.n_intr_overruns = saturate_u16(gpio_intr_get_overruns());
 
-                if (led_state == GPIO_STATE_HIGH)
-                        led_state = GPIO_STATE_LOW;
-                else
-                        led_state = GPIO_STATE_HIGH;
+        record.crc = record_crc(&record);
 
+        disable_all_gpio_ports();
+
+        GPIO_PIN_HIGH(PANIC_LED_PIN);
+        GPIO_PIN_OUTPUT(PANIC_LED_PIN);
+
+        /* NOTE: Reset comes within 15 ms, the LED flashes once on the way */
+        wdt_enable(WDTO_15MS);
+
+        for (;;) {
+                GPIO_PIN_TOGGLE(PANIC_LED_PIN);
                 _delay_ms(70.0);
         }
 }
+
+void panic(void)
+{
+        crash(PANIC_REASON_UNKNOWN, NULL, __builtin_return_address(0));
+}
+
+void panic_reason(enum panic_reason reason)
+{
+        crash(reason, NULL, __builtin_return_address(0));
+}
+
+void panic_reason_detail_P(enum panic_reason reason, const char *detail)
+{
+        crash(reason, detail, __builtin_return_address(0));
+}
+
+uint8_t panic_get_reset_flags(void)
+{
+        return reset_flags;
+}
+
+bool panic_get_last_record(struct panic_record *r)
+{
+        if (record.magic != PANIC_RECORD_MAGIC || record.crc != record_crc(&record))
+                return false;
+
+        memcpy(r, &record, sizeof(struct panic_record));
+
+
+        return true;
+}
+
+void panic_report(void)
+{
+        static char const reason_unknown[] PROGMEM = "unknown";
+        static char const reason_setup[] PROGMEM = "setup";
+        static char const reason_stack_overflow[] PROGMEM = "stack-overflow";
+        static char const reason_watchdog[] PROGMEM = "watchdog";
+
+        static const char * const reason_names[N_PANIC_REASONS] PROGMEM = {
+                [PANIC_REASON_UNKNOWN] = reason_unknown,
+                [PANIC_REASON_SETUP] = reason_setup,
+                [PANIC_REASON_STACK_OVERFLOW] = reason_stack_overflow,
+                [PANIC_REASON_WATCHDOG] = reason_watchdog
+        };
+
+        struct panic_record r;
+        const char *name = NULL;
+
+
+        printf_P(PSTR("// reset flags: 0x%02x%S%S%S%S%S\n"), reset_flags,
+                 (reset_flags & _BV(PORF)) ? PSTR(" power-on") : PSTR(""),
+                 (reset_flags & _BV(EXTRF)) ? PSTR(" external") : PSTR(""),
+                 (reset_flags & _BV(BORF)) ? PSTR(" brown-out") : PSTR(""),
+                 (reset_flags & _BV(WDRF)) ? PSTR(" watchdog") : PSTR(""),
+#ifdef JTRF
+                 (reset_flags & _BV(JTRF)) ? PSTR(" jtag") : PSTR(""));
+#else
+                 PSTR(""));
+#endif
+
+        if (!panic_get_last_record(&r))
+                return;
+
+        name = (r.reason < N_PANIC_REASONS) ? (const char *) pgm_read_ptr(&reason_names[r.reason])
+                                            : reason_unknown;
+
+        printf_P(PSTR("// previous crash: %S %s at 0x%05lx sp 0x%04x uptime %lu.%03lu\n"),
+                 name, r.detail, (unsigned long) r.return_addr * 2ul, r.sp,
+                 r.uptime_msecs / 1000ul, r.uptime_msecs % 1000ul);
+
+        printf_P(PSTR("// stack free %u log dropped %u intr overruns %u\n"),
+                 r.stack_free, r.n_log_dropped, r.n_intr_overruns);
+
+        /* Report only once */
+        record.magic = 0u;
+}
@@ -25,12 +25,53 @@
 #define PANIC_H
 
 #include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
-void panic(void);
+enum panic_reason {
+        PANIC_REASON_UNKNOWN = 0,
+        PANIC_REASON_SETUP,
+        PANIC_REASON_STACK_OVERFLOW,
+        PANIC_REASON_WATCHDOG,
+
+        N_PANIC_REASONS
+};
+
+#define PANIC_DETAIL_SIZE 8
+
+/*
+ * NOTE: Record survives the watchdog reset in .noinit section. It is valid only if
+ *       magic and CRC match, otherwise SRAM holds power-on garbage.
+ */
+struct panic_record {
+        uint16_t magic;
+
+        uint8_t reason;
+        char detail[PANIC_DETAIL_SIZE];     /* E.g. name of the task that hung */
+        uint16_t return_addr;   /* Word address of the caller, as in the .lss listing / 2 */
+        uint16_t sp;
+        unsigned long uptime_msecs;
+
+        /* Subsystem counters at the moment of crash */
+        uint16_t stack_free;
+        uint16_t n_log_dropped;
+        uint16_t n_intr_overruns;
+
+        uint16_t crc;
+};
+
+void panic(void) __attribute__((noreturn));
+void panic_reason(enum panic_reason reason) __attribute__((noreturn));
+void panic_reason_detail_P(enum panic_reason reason, const char *detail) __attribute__((noreturn));
+uint8_t panic_get_reset_flags(void);
+bool panic_get_last_record(struct panic_record *record);
+
+/* NOTE: Prints through stdout, call it with interrupts enabled or TX FIFO never drains */
+void panic_report(void);
 
 #ifdef __cplusplus
 }
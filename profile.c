@@ -0,0 +1,147 @@
+#include <stdio.h>
+#include <string.h>
+#include <avr/pgmspace.h>
+#include <util/atomic.h>
+
+#include "profile.h"
+
+#ifdef PROFILE_ENABLE
+
+static struct profile_stats stats_table[N_PROFILE_REGIONS];
+
+/* Cost of an empty BEGIN/END pair, it is subtracted from every sample */
+static uint16_t overhead = 0u;
+
+static char const region_name_uart_rx_isr[] PROGMEM = "uart_rx_isr";
+static char const region_name_uart_udre_isr[] PROGMEM = "uart_udre_isr";
+static char const region_name_fifo_put_byte[] PROGMEM = "fifo_put_byte";
+static char const region_name_fifo_get_byte[] PROGMEM = "fifo_get_byte";
+static char const region_name_crc16_byte[] PROGMEM = "crc16_byte";
+static char const region_name_modbus_recv_async[] PROGMEM = "modbus_recv_async";
+
+static const char * const region_names[N_PROFILE_REGIONS] PROGMEM = {
+        [PROFILE_REGION_UART_RX_ISR] = region_name_uart_rx_isr,
+        [PROFILE_REGION_UART_UDRE_ISR] = region_name_uart_udre_isr,
+        [PROFILE_REGION_FIFO_PUT_BYTE] = region_name_fifo_put_byte,
+        [PROFILE_REGION_FIFO_GET_BYTE] = region_name_fifo_get_byte,
+        [PROFILE_REGION_CRC16_BYTE] = region_name_crc16_byte,
+        [PROFILE_REGION_MODBUS_RECV_ASYNC] = region_name_modbus_recv_async
+};
+
+static inline uint8_t histogram_bucket(uint16_t cycles)
+{
+        uint8_t bucket = 0u;
+
+
+        while (cycles != 0u) {
+                cycles >>= 1;
+                bucket++;
+        }
+
+
+        return bucket;
+}
+
+static void stats_clear(struct profile_stats *stats)
+{
+        memset(stats, 0, sizeof(struct profile_stats));
+
+        stats->min = UINT16_MAX;
+}
+
+void profile_reset(void)
+{
+        size_t i = 0u;
+
+
+        ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+                for (; i < N_PROFILE_REGIONS; ++i)
+                        stats_clear(&stats_table[i]);
+        }
+}
+
+void profile_setup(void)
+{
+        uint16_t start = 0u;
+
+
+        hrtimer_setup();
+        profile_reset();
+
+        /* Calibrate: measure the markers themselves */
+        start = hrtimer_now();
+        overhead = hrtimer_elapsed(start);
+}
+
+void profile_record(enum profile_region region, uint16_t cycles)
+{
+        struct profile_stats *stats = NULL;
+
+
+        if ((size_t) region >= N_PROFILE_REGIONS)
+                return;
+
+        cycles = (cycles > overhead) ? (uint16_t) (cycles - overhead) : 0u;
+        stats = &stats_table[region];
+
+        ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+                if (stats->count != UINT32_MAX)
+                        stats->count++;
+
+                /* NOTE: Saturate instead of wrapping, so overflow is visible in the dump */
+                if (stats->total <= UINT32_MAX - cycles)
+                        stats->total += cycles;
+                else
+                        stats->total = UINT32_MAX;
+
+                if (cycles < stats->min)
+                        stats->min = cycles;
+                if (cycles > stats->max)
+                        stats->max = cycles;
+
+                if (stats->histogram[histogram_bucket(cycles)] != UINT16_MAX)
+                        stats->histogram[histogram_bucket(cycles)]++;
+        }
+}
+
+void profile_get_stats(enum profile_region region, struct profile_stats *stats)
+{
+        if ((size_t) region >= N_PROFILE_REGIONS)
+                return;
+
+        ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+                memcpy(stats, &stats_table[region], sizeof(struct profile_stats));
+        }
+}
+
+void profile_dump(void)
+{
+        struct profile_stats stats;
+        size_t i = 0u;
+        size_t j = 0u;
+
+
+        printf_P(PSTR("// profile: region count min max avg total (cycles)\n"));
+
+        for (; i < N_PROFILE_REGIONS; ++i) {
+                profile_get_stats((enum profile_region) i, &stats);
+                if (stats.count == 0u)
+                        continue;
+
+                printf_P(PSTR("%S %lu %u %u %lu %lu\n"),
+                         (const char *) pgm_read_ptr(&region_names[i]),
+                         (unsigned long) stats.count,
+                         stats.min,
+                         stats.max,
+                         (unsigned long) (stats.total / stats.count),
+                         (unsigned long) stats.total);
+
+                printf_P(PSTR("// histogram:"));
+                for (j = 0u; j < PROFILE_HISTOGRAM_SIZE; ++j)
+                        printf_P(PSTR(" %u"), stats.histogram[j]);
+
+                printf_P(PSTR("\n"));
+        }
+}
+
+#endif /* PROFILE_ENABLE */
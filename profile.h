@@ -0,0 +1,95 @@
+/*
+ * Copyright (c) 2018 Sereda Anton
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ */
+
+#ifndef PROFILE_H
+#define PROFILE_H
+
+#include <stdint.h>
+
+#ifdef PROFILE_ENABLE
+#include "hrtimer.h"
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * NOTE: Profiling is compiled in only when PROFILE_ENABLE is defined (make profile=1),
+ *       otherwise all markers expand to nothing and no memory is reserved.
+ */
+
+#define PROFILE_HISTOGRAM_SIZE 17
+
+enum profile_region {
+        PROFILE_REGION_UART_RX_ISR = 0,
+        PROFILE_REGION_UART_UDRE_ISR,
+        PROFILE_REGION_FIFO_PUT_BYTE,
+        PROFILE_REGION_FIFO_GET_BYTE,
+        PROFILE_REGION_CRC16_BYTE,
+        PROFILE_REGION_MODBUS_RECV_ASYNC,
+
+        N_PROFILE_REGIONS
+};
+
+struct profile_stats {
+        uint32_t count;
+        uint32_t total;
+
+        uint16_t min;
+        uint16_t max;
+
+        /* Bucket N counts samples in range [2^(N-1), 2^N) cycles, bucket 0 counts zeroes */
+        uint16_t histogram[PROFILE_HISTOGRAM_SIZE];
+};
+
+#ifdef PROFILE_ENABLE
+
+#define PROFILE_BEGIN(region)                                                   \
+        uint16_t _profile_start_##region = hrtimer_now()
+
+#define PROFILE_END(region)                                                     \
+        profile_record((region), hrtimer_elapsed(_profile_start_##region))
+
+void profile_setup(void);
+void profile_reset(void);
+void profile_record(enum profile_region region, uint16_t cycles);
+void profile_get_stats(enum profile_region region, struct profile_stats *stats);
+void profile_dump(void);
+
+#else
+
+#define PROFILE_BEGIN(region)   do { } while (0)
+#define PROFILE_END(region)     do { } while (0)
+
+static inline void profile_setup(void) { }
+static inline void profile_reset(void) { }
+static inline void profile_dump(void) { }
+
+#endif /* PROFILE_ENABLE */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* PROFILE_H */
@@ -0,0 +1,11 @@
+#!/bin/sh
+#
+# Builds core modules for the host and runs unit tests from tests/
+#
+
+set -e
+
+cd "$(dirname "$0")/tests"
+
+make all
+make run
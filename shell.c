@@ -0,0 +1,490 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <avr/pgmspace.h>
+
+#include "shell.h"
+#include "json-writer.h"
+#include "mem-pool.h"
+#include "mem-monitor.h"
+#include "profile.h"
+#include "latency.h"
+#include "config.h"
+#include "supervisor.h"
+
+#define SHELL_MODBUS_TIMEOUT_MSEC 1000u
+
+/* NOTE: Transaction ends by timeout above, missed deadline means shell stopped polling it */
+#define SHELL_MODBUS_DEADLINE_MSEC 1500ul
+
+static enum shell_result cmd_help(struct shell *sh, int argc, char **argv);
+static enum shell_result cmd_uart(struct shell *sh, int argc, char **argv);
+static enum shell_result cmd_modbus(struct shell *sh, int argc, char **argv);
+static enum shell_result cmd_mem(struct shell *sh, int argc, char **argv);
+static enum shell_result cmd_prof(struct shell *sh, int argc, char **argv);
+static enum shell_result cmd_lat(struct shell *sh, int argc, char **argv);
+static enum shell_result cmd_config(struct shell *sh, int argc, char **argv);
+
+static struct shell_cmd const builtin_commands[] PROGMEM = {
+        { "help",   cmd_help,   "list commands" },
+        { "uart",   cmd_uart,   "[clear] receiver error counters" },
+        { "modbus", cmd_modbus, "<slave> <func> <addr> <qty|value>" },
+        { "mem",    cmd_mem,    "SRAM, pool and arena usage" },
+        { "prof",   cmd_prof,   "[reset] profiling statistics" },
+        { "lat",    cmd_lat,    "[reset] interrupt latency statistics" },
+        { "config", cmd_config, "[save|defaults|<key> <params>]" }
+};
+
+#define N_BUILTIN_COMMANDS (sizeof(builtin_commands) / sizeof(builtin_commands[0]))
+
+static inline bool parse_ulong(const char *str, unsigned long max, unsigned long *value)
+{
+        char *end = NULL;
+
+
+        *value = strtoul(str, &end, 0);
+
+
+        return end != str && *end == '\0' && *value <= max;
+}
+
+static inline bool is_arg_P(const char *arg, const char *name)
+{
+        return strcmp_P(arg, name) == 0;
+}
+
+static void print_commands(const struct shell_cmd *commands, size_t n_commands)
+{
+        size_t i = 0u;
+
+
+        for (; i < n_commands; ++i)
+                printf_P(PSTR("%-8S %S\n"), commands[i].name, commands[i].help);
+}
+
+static enum shell_result cmd_help(struct shell *sh, int argc, char **argv)
+{
+        print_commands(builtin_commands, N_BUILTIN_COMMANDS);
+
+        if (sh->app_commands != NULL)
+                print_commands(sh->app_commands, sh->n_app_commands);
+
+
+        return SHELL_RESULT_OK;
+}
+
+static void print_uart_stats(const char *name, struct uart *dev, bool clear)
+{
+        struct uart_stats stats;
+
+
+        uart_get_stats(dev, &stats);
+
+        if (clear)
+                uart_clear_stats(dev);
+
+        printf_P(PSTR("%S: frame %u overrun %u parity %u dropped %u\n"), name,
+                 stats.n_frame_errors, stats.n_overruns, stats.n_parity_errors, stats.n_dropped);
+}
+
+static enum shell_result cmd_uart(struct shell *sh, int argc, char **argv)
+{
+        struct modbus_rtu *rtu = NULL;
+        bool clear = false;
+
+
+        if (argc > 2 || (argc == 2 && !(clear = is_arg_P(argv[1], PSTR("clear")))))
+                return SHELL_RESULT_USAGE;
+
+        print_uart_stats(PSTR("console"), sh->dev, clear);
+
+        if ((rtu = modbus_rtu_get_instance()) != NULL)
+                print_uart_stats(PSTR("modbus"), &rtu->uart, clear);
+
+
+        return SHELL_RESULT_OK;
+}
+
+static enum shell_result modbus_complete(struct shell *sh, enum shell_result result)
+{
+        modbus_rtu_async_free(sh->modbus_async);
+        sh->modbus_async = NULL;
+
+        supervisor_disarm(sh->modbus_task);
+
+
+        return result;
+}
+
+static enum shell_result cmd_modbus(struct shell *sh, int argc, char **argv)
+{
+        struct modbus_rtu *rtu = NULL;
+        struct modbus_req req;
+        struct json_writer w;
+        enum modbus_result result = MODBUS_RESULT_INCOMPLETE;
+        unsigned long slave_addr = 0ul;
+        unsigned long func_code = 0ul;
+        unsigned long addr = 0ul;
+        unsigned long quantity = 0ul;
+        uint8_t data[2];
+
+
+        if ((rtu = modbus_rtu_get_instance()) == NULL)
+                return SHELL_RESULT_ERROR;
+
+        if (argc == 0) {
+                /* NOTE: Request drains from TX FIFO in UDRE interrupt, DE is released after it */
+                if (!modbus_rtu_send_is_completed(rtu))
+                        result = MODBUS_RESULT_INCOMPLETE;
+                else
+                        result = modbus_rtu_recv_async(rtu, sh->modbus_async);
+
+                if (result == MODBUS_RESULT_INCOMPLETE) {
+                        if (!timer_expired(&sh->timer))
+                                return SHELL_RESULT_PENDING;
+
+                        printf_P(PSTR("timeout\n"));
+                        return modbus_complete(sh, SHELL_RESULT_ERROR);
+                }
+
+                if (result != MODBUS_RESULT_OK) {
+                        printf_P(PSTR("error %d\n"), (int) result);
+                        return modbus_complete(sh, SHELL_RESULT_ERROR);
+                }
+
+                json_writer_init_uart(&w, sh->dev);
+                modbus_resp_json_write(&sh->modbus_async->resp, &w);
+                json_writer_finish(&w);
+
+                printf_P(PSTR("\n"));
+                return modbus_complete(sh, SHELL_RESULT_OK);
+        }
+
+        if (argc != 5 || !parse_ulong(argv[1], 247ul, &slave_addr)
+                        || !parse_ulong(argv[2], 0x7ful, &func_code)
+                        || !parse_ulong(argv[3], 0xfffful, &addr)
+                        || !parse_ulong(argv[4], 0xfffful, &quantity)) {
+
+                return SHELL_RESULT_USAGE;
+        }
+
+        data[0] = (uint8_t) (addr >> 8);
+        data[1] = (uint8_t) (addr & 0xffu);
+
+        modbus_req_clear(&req);
+        req.slave_addr = (uint8_t) slave_addr;
+        req.func_code = (uint8_t) func_code;
+        req.data = data;
+        req.data_size = sizeof(data);
+        req.quantity = (uint16_t) quantity;
+
+        /* NOTE: Receiver must be armed before request leaves the wire */
+        if ((sh->modbus_async = modbus_rtu_async_alloc()) == NULL)
+                return SHELL_RESULT_ERROR;
+
+        timer_set_msecs(&sh->timer, SHELL_MODBUS_TIMEOUT_MSEC);
+        supervisor_arm(sh->modbus_task);
+
+        modbus_rtu_send_async(rtu, &req);
+
+
+        return SHELL_RESULT_PENDING;
+}
+
+static void print_pool_stats(const char *name, struct mem_pool *pool)
+{
+        struct mem_pool_stats stats;
+
+
+        mem_pool_get_stats(pool, &stats);
+
+        printf_P(PSTR("%S: %u x %u bytes, used %u max %u failed %u\n"), name,
+                 stats.n_blocks, (unsigned) stats.block_size, stats.n_used, stats.max_used,
+                 stats.n_failures);
+}
+
+static enum shell_result cmd_mem(struct shell *sh, int argc, char **argv)
+{
+        mem_monitor_dump();
+
+        print_pool_stats(PSTR("modbus"), modbus_rtu_get_async_pool());
+
+        printf_P(PSTR("scratch: %u bytes, max %u failed %u\n"), (unsigned) mem_scratch.size,
+                 (unsigned) mem_scratch.max_used, mem_scratch.n_failures);
+
+
+        return SHELL_RESULT_OK;
+}
+
+static enum shell_result cmd_prof(struct shell *sh, int argc, char **argv)
+{
+        if (argc == 1)
+                profile_dump();
+        else if (argc == 2 && is_arg_P(argv[1], PSTR("reset")))
+                profile_reset();
+        else
+                return SHELL_RESULT_USAGE;
+
+
+        return SHELL_RESULT_OK;
+}
+
+static enum shell_result cmd_lat(struct shell *sh, int argc, char **argv)
+{
+        if (argc == 1)
+                latency_dump();
+        else if (argc == 2 && is_arg_P(argv[1], PSTR("reset")))
+                latency_reset();
+        else
+                return SHELL_RESULT_USAGE;
+
+
+        return SHELL_RESULT_OK;
+}
+
+static void print_uart_params(const struct uart_params *params)
+{
+        printf_P(PSTR("UART%u:%lu@%u%c%u"), params->dev_num, (unsigned long) params->baud_rate,
+                 params->frame_size, params->parity_sign, params->n_stop_bits);
+}
+
+static void print_gpio_params(const struct gpio_params *params)
+{
+        if (params->port_letter != '\0')
+                printf_P(PSTR("PORT%c:%u"), params->port_letter, params->bit);
+        else
+                printf_P(PSTR("-"));
+}
+
+static void print_config(struct config *cfg, bool is_edited)
+{
+        printf_P(PSTR("source: %S%S\n"), (config_get_source() == CONFIG_SOURCE_EEPROM)
+                 ? PSTR("eeprom") : PSTR("defaults"), is_edited ? PSTR(", edited") : PSTR(""));
+
+        printf_P(PSTR("console "));
+        print_uart_params(&cfg->console);
+
+        /* NOTE: Printed in the same format the parameters are set with */
+        printf_P(PSTR("\nmodbus uart="));
+        print_uart_params(&cfg->modbus.uart);
+        if (cfg->modbus.de_port.port_letter != '\0') {
+                printf_P(PSTR(",de_port="));
+                print_gpio_params(&cfg->modbus.de_port);
+        }
+
+        printf_P(PSTR("\ndht "));
+        print_gpio_params(&cfg->dht_port);
+        printf_P(PSTR("\n"));
+}
+
+static bool set_config(struct config *cfg, const char *key, const char *params)
+{
+        struct config tmp;
+
+
+        /* NOTE: Working copy changes only if the whole value parses */
+        tmp = *cfg;
+
+        if (is_arg_P(key, PSTR("console"))) {
+                if (!uart_parse_params(&tmp.console, params))
+                        return false;
+        } else if (is_arg_P(key, PSTR("modbus"))) {
+                if (!modbus_rtu_parse_params(&tmp.modbus, params))
+                        return false;
+        } else if (is_arg_P(key, PSTR("dht"))) {
+                if (!gpio_parse_params(&tmp.dht_port, params))
+                        return false;
+        } else
+                return false;
+
+        /* NOTE: ModBus on console UART would cut off the shell on every boot */
+        if (tmp.modbus.uart.dev_num == tmp.console.dev_num)
+                return false;
+
+        *cfg = tmp;
+
+
+        return true;
+}
+
+static enum shell_result cmd_config(struct shell *sh, int argc, char **argv)
+{
+        if (argc == 1) {
+                print_config(&sh->config, sh->is_config_edited);
+                return SHELL_RESULT_OK;
+        }
+
+        if (argc == 2 && is_arg_P(argv[1], PSTR("save"))) {
+                config_save(&sh->config);
+                sh->is_config_edited = false;
+                printf_P(PSTR("saved, reset to apply\n"));
+                return SHELL_RESULT_OK;
+        }
+
+        if (argc == 2 && is_arg_P(argv[1], PSTR("defaults"))) {
+                config_load_defaults(&sh->config);
+                sh->is_config_edited = true;
+                return SHELL_RESULT_OK;
+        }
+
+        if (argc != 3 || !set_config(&sh->config, argv[1], argv[2]))
+                return SHELL_RESULT_USAGE;
+
+        sh->is_config_edited = true;
+
+
+        return SHELL_RESULT_OK;
+}
+
+static const struct shell_cmd *find_command(const struct shell_cmd *commands,
+                                            size_t n_commands, const char *name)
+{
+        size_t i = 0u;
+
+
+        for (; i < n_commands; ++i) {
+                if (strcmp_P(name, commands[i].name) == 0)
+                        return &commands[i];
+        }
+
+
+        return NULL;
+}
+
+static int tokenize(char *line, char **argv)
+{
+        int argc = 0;
+        char *save_ptr = NULL;
+        char *s = NULL;
+
+
+        /* NOTE: Tokens are terminated in place, argv points into the line buffer */
+        for (s = strtok_r(line, " \t", &save_ptr); s != NULL; s = strtok_r(NULL, " \t", &save_ptr)) {
+                if (argc == SHELL_MAX_ARGS)
+                        return -1;
+
+                argv[argc++] = s;
+        }
+
+
+        return argc;
+}
+
+static inline void print_prompt(void)
+{
+        printf_P(PSTR("> "));
+}
+
+static void complete(struct shell *sh, const struct shell_cmd *cmd, enum shell_result result)
+{
+        if (result == SHELL_RESULT_PENDING) {
+                sh->pending = cmd;
+                return;
+        }
+
+        sh->pending = NULL;
+
+        if (result == SHELL_RESULT_USAGE)
+                printf_P(PSTR("usage: %S %S\n"), cmd->name, cmd->help);
+        else if (result == SHELL_RESULT_ERROR)
+                printf_P(PSTR("failed\n"));
+
+        print_prompt();
+}
+
+static void execute(struct shell *sh)
+{
+        char *argv[SHELL_MAX_ARGS];
+        int argc = 0;
+        const struct shell_cmd *cmd = NULL;
+        shell_handler handler = NULL;
+
+
+        if ((argc = tokenize(sh->line, argv)) <= 0) {
+                if (argc < 0)
+                        printf_P(PSTR("too many arguments\n"));
+
+                print_prompt();
+                return;
+        }
+
+        cmd = find_command(builtin_commands, N_BUILTIN_COMMANDS, argv[0]);
+
+        if (cmd == NULL && sh->app_commands != NULL)
+                cmd = find_command(sh->app_commands, sh->n_app_commands, argv[0]);
+
+        if (cmd == NULL) {
+                printf_P(PSTR("%s: unknown command\n"), argv[0]);
+                print_prompt();
+                return;
+        }
+
+        handler = (shell_handler) pgm_read_ptr(&cmd->handler);
+        complete(sh, cmd, handler(sh, argc, argv));
+}
+
+void shell_init(struct shell *sh, struct uart *dev,
+                const struct shell_cmd *app_commands, size_t n_app_commands)
+{
+        memset(sh, 0, sizeof(struct shell));
+
+        sh->dev = dev;
+        sh->app_commands = app_commands;
+        sh->n_app_commands = n_app_commands;
+        sh->config = *config_get();
+
+        sh->modbus_task = supervisor_register_P(PSTR("modbus"), SHELL_MODBUS_DEADLINE_MSEC);
+        supervisor_disarm(sh->modbus_task);
+
+        timer_clear(&sh->timer);
+        print_prompt();
+}
+
+void shell_poll(struct shell *sh)
+{
+        uint8_t byte = 0u;
+        shell_handler handler = NULL;
+
+
+        if (sh->pending != NULL) {
+                handler = (shell_handler) pgm_read_ptr(&sh->pending->handler);
+                complete(sh, sh->pending, handler(sh, 0, NULL));
+                return;
+        }
+
+        /* NOTE: Consume only what is already received, at most one line per call */
+        while (uart_read_byte(sh->dev, &byte, UART_FLAG_NONBLOCK | UART_FLAG_TEXT_MODE) == UART_RESULT_OK) {
+                if (byte == (uint8_t) '\n') {
+                        uart_write_byte(sh->dev, byte, UART_FLAG_NONBLOCK | UART_FLAG_TEXT_MODE);
+
+                        if (sh->is_overflow) {
+                                printf_P(PSTR("line too long\n"));
+                                print_prompt();
+                        } else {
+                                sh->line[sh->line_size] = '\0';
+                                execute(sh);
+                        }
+
+                        sh->line_size = 0u;
+                        sh->is_overflow = false;
+                        return;
+                }
+
+                if (byte == (uint8_t) '\b' || byte == 0x7fu) {
+                        if (sh->line_size > 0u) {
+                                sh->line_size--;
+                                printf_P(PSTR("\b \b"));
+                        }
+
+                        continue;
+                }
+
+                if (sh->line_size + 1u >= sizeof(sh->line)) {
+                        sh->is_overflow = true;
+                        continue;
+                }
+
+                sh->line[sh->line_size++] = (char) byte;
+                uart_write_byte(sh->dev, byte, UART_FLAG_NONBLOCK);
+        }
+}
@@ -0,0 +1,97 @@
+/*
+ * Copyright (c) 2018 Sereda Anton
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ */
+
+#ifndef SHELL_H
+#define SHELL_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <avr/pgmspace.h>
+
+#include "uart.h"
+#include "timer.h"
+#include "modbus-rtu.h"
+#include "config.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define SHELL_LINE_SIZE         64
+#define SHELL_MAX_ARGS          8
+#define SHELL_CMD_NAME_SIZE     8
+#define SHELL_CMD_HELP_SIZE     40
+
+enum shell_result {
+        SHELL_RESULT_OK = 0,
+        SHELL_RESULT_PENDING,
+        SHELL_RESULT_USAGE,
+        SHELL_RESULT_ERROR
+};
+
+struct shell;
+
+/*
+ * NOTE: Handler returning SHELL_RESULT_PENDING is called again from shell_poll()
+ *       with argc == 0 until it returns anything else. Input is not read meanwhile.
+ */
+typedef enum shell_result (*shell_handler)(struct shell *sh, int argc, char **argv);
+
+/* NOTE: Command tables are stored in PROGMEM */
+struct shell_cmd {
+        char name[SHELL_CMD_NAME_SIZE];
+        shell_handler handler;
+        char help[SHELL_CMD_HELP_SIZE];
+};
+
+struct shell {
+        struct uart *dev;
+
+        const struct shell_cmd *app_commands;
+        size_t n_app_commands;
+
+        char line[SHELL_LINE_SIZE];
+        size_t line_size;
+        bool is_overflow;
+
+        const struct shell_cmd *pending;
+
+        /* State of pending built-in commands */
+        struct timer timer;
+        struct modbus_rtu_async *modbus_async;
+        uint8_t modbus_task;
+
+        /* NOTE: "config" edits this copy, settings in use are applied after reset */
+        struct config config;
+        bool is_config_edited;
+};
+
+void shell_init(struct shell *sh, struct uart *dev,
+                const struct shell_cmd *app_commands, size_t n_app_commands);
+void shell_poll(struct shell *sh);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SHELL_H */
@@ -0,0 +1,96 @@
+#!/bin/sh
+#
+# Prints flash and SRAM usage of firmware by module and by symbol, then checks module
+# sizes against budget file. Exits with non-zero status if any budget is exceeded.
+#
+# Usage: size-report.sh ELF BUDGET OBJECTS...
+#
+# Budget file has "<module> <flash> <sram>" lines, module "total" is the whole firmware.
+# Flash of a module is its code, PROGMEM and .data initializers, SRAM is .data and .bss.
+#
+
+set -e
+
+size=${SIZE:-avr-size}
+nm=${NM:-avr-nm}
+n_symbols=${N_SYMBOLS:-15}
+
+if [ $# -lt 2 ]; then
+	echo "usage: $0 ELF BUDGET OBJECTS..." >&2
+	exit 2
+fi
+
+elf="$1"
+budget="$2"
+shift 2
+
+modules=$(mktemp)
+trap 'rm -f "$modules"' EXIT
+
+# NOTE: avr-size prints "text data bss dec hex filename" in Berkeley format
+$size "$@" | awk 'NR > 1 {
+	name = $6
+	sub(/^.*\//, "", name)
+	sub(/\.o$/, "", name)
+	print name, $1 + $2, $2 + $3
+}' > "$modules"
+
+$size "$elf" | awk -v modules="$modules" 'NR == 2 {
+	total_flash = $1 + $2
+	total_sram = $2 + $3
+
+	while ((getline line < modules) > 0) {
+		split(line, field, " ")
+		flash += field[2]
+		sram += field[3]
+	}
+
+	printf "total %d %d\n", total_flash, total_sram
+	printf "other %d %d\n", total_flash - flash, total_sram - sram
+}' >> "$modules"
+
+echo "Module                   flash     sram"
+sort -k2,2nr "$modules" | awk '$1 != "total" { printf "%-20s %9d %8d\n", $1, $2, $3 }'
+awk '$1 == "total" { printf "%-20s %9d %8d\n", $1, $2, $3 }' "$modules"
+
+# NOTE: Flash symbols are below 0x800000 in AVR ELF address space, SRAM is 0x800000-0x80ffff
+echo
+echo "Largest flash symbols:"
+$nm -S --size-sort -r -t d "$elf" | awk -v n="$n_symbols" '
+NF == 4 && $1 < 8388608 && count++ < n { printf "%9d %s %s\n", $2, $3, $4 }'
+
+echo
+echo "Largest SRAM symbols:"
+$nm -S --size-sort -r -t d "$elf" | awk -v n="$n_symbols" '
+NF == 4 && $1 >= 8388608 && $1 < 8454144 && count++ < n {
+	printf "%9d %s %s\n", $2, $3, $4
+}'
+
+echo
+awk '
+/^#/ || NF == 0 { next }
+FNR == NR { flash[$1] = $2; sram[$1] = $3; next }
+{
+	if (!($1 in flash)) {
+		if ($1 != "other")
+			printf "%s: no budget for module\n", $1
+		next
+	}
+
+	if ($2 > flash[$1]) {
+		printf "%s: flash %d exceeds budget %d\n", $1, $2, flash[$1]
+		failed = 1
+	}
+
+	if ($3 > sram[$1]) {
+		printf "%s: SRAM %d exceeds budget %d\n", $1, $3, sram[$1]
+		failed = 1
+	}
+}
+END {
+	if (failed)
+		exit 1
+
+	print "All modules are within budget"
+}
+' "$budget" "$modules"
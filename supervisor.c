@@ -0,0 +1,136 @@
+#include <stddef.h>
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <avr/pgmspace.h>
+#include <avr/wdt.h>
+#include <util/atomic.h>
+
+#include "supervisor.h"
+#include "clock.h"
+#include "panic.h"
+
+static struct supervisor_task tasks[SUPERVISOR_MAX_TASKS];
+static uint8_t n_tasks = 0u;
+
+uint8_t supervisor_register_P(const char *name, unsigned long deadline_msecs)
+{
+        uint8_t task = SUPERVISOR_INVALID_TASK;
+
+
+        ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+                if (n_tasks < SUPERVISOR_MAX_TASKS) {
+                        task = n_tasks++;
+
+                        tasks[task].name = name;
+                        tasks[task].deadline_msecs = deadline_msecs;
+                        tasks[task].last_msecs = clock_get_msecs();
+                        tasks[task].is_armed = true;
+                }
+        }
+
+
+        return task;
+}
+
+void supervisor_checkin(uint8_t task)
+{
+        unsigned long now = 0ul;
+
+
+        if (task >= n_tasks)
+                return;
+
+        now = clock_get_msecs();
+
+        ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+                tasks[task].last_msecs = now;
+        }
+}
+
+void supervisor_arm(uint8_t task)
+{
+        unsigned long now = 0ul;
+
+
+        if (task >= n_tasks)
+                return;
+
+        now = clock_get_msecs();
+
+        ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+                tasks[task].last_msecs = now;
+                tasks[task].is_armed = true;
+        }
+}
+
+void supervisor_disarm(uint8_t task)
+{
+        if (task >= n_tasks)
+                return;
+
+        ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+                tasks[task].is_armed = false;
+        }
+}
+
+void supervisor_start(void)
+{
+        ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+                wdt_enable(SUPERVISOR_WDT_TIMEOUT);
+                WDTCSR |= (uint8_t) _BV(WDIE);
+        }
+}
+
+uint8_t supervisor_get_late_task(void)
+{
+        unsigned long now = 0ul;
+        uint8_t task = SUPERVISOR_INVALID_TASK;
+        uint8_t i = 0u;
+
+
+        now = clock_get_msecs();
+
+        ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+                for (; i < n_tasks; ++i) {
+                        /* NOTE: Unsigned difference stays correct when milliseconds wrap */
+                        if (tasks[i].is_armed
+                                        && now - tasks[i].last_msecs > tasks[i].deadline_msecs) {
+                                task = i;
+                                break;
+                        }
+                }
+        }
+
+
+        return task;
+}
+
+bool supervisor_poll(void)
+{
+        if (supervisor_get_late_task() != SUPERVISOR_INVALID_TASK)
+                return false;
+
+        /* Feed the dog and re-arm its interrupt, hardware clears WDIE when it fires */
+        ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+                wdt_reset();
+                WDTCSR |= (uint8_t) _BV(WDIE);
+        }
+
+
+        return true;
+}
+
+ISR(WDT_vect)
+{
+        uint8_t task = SUPERVISOR_INVALID_TASK;
+
+
+        /*
+         * NOTE: No task is late if the main loop stopped calling supervisor_poll()
+         *       between check-ins, the record then has no task name.
+         */
+        task = supervisor_get_late_task();
+
+        panic_reason_detail_P(PANIC_REASON_WATCHDOG,
+                              task != SUPERVISOR_INVALID_TASK ? tasks[task].name : NULL);
+}
@@ -0,0 +1,74 @@
+/*
+ * Copyright (c) 2018 Sereda Anton
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ */
+
+#ifndef SUPERVISOR_H
+#define SUPERVISOR_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <avr/wdt.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifndef SUPERVISOR_MAX_TASKS
+#define SUPERVISOR_MAX_TASKS 8
+#endif
+
+/* NOTE: Hardware timeout must be longer than any task deadline */
+#ifndef SUPERVISOR_WDT_TIMEOUT
+#define SUPERVISOR_WDT_TIMEOUT WDTO_2S
+#endif
+
+#define SUPERVISOR_INVALID_TASK 0xff
+
+/*
+ * NOTE: Registered task is armed, so it must check in periodically. Task that only has
+ *       work from time to time (e.g. a ModBus transaction) is disarmed while idle, armed
+ *       when work starts and disarmed again when it completes.
+ *
+ *       Watchdog runs in interrupt and reset mode. First timeout calls the WDT ISR,
+ *       which finds the late task, stores it in the crash record and resets the MCU.
+ *       Hardware watchdog is fed by supervisor_poll() only if all tasks are in time.
+ */
+struct supervisor_task {
+        const char *name;               /* PROGMEM */
+        unsigned long deadline_msecs;
+        unsigned long last_msecs;
+        bool is_armed;                  /* Deadline is checked only while task is armed */
+};
+
+uint8_t supervisor_register_P(const char *name, unsigned long deadline_msecs);
+void supervisor_checkin(uint8_t task);
+void supervisor_arm(uint8_t task);
+void supervisor_disarm(uint8_t task);
+void supervisor_start(void);
+bool supervisor_poll(void);
+uint8_t supervisor_get_late_task(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SUPERVISOR_H */
@@ -0,0 +1,9 @@
+/* Host shim of <avr/cpufunc.h> */
+
+#ifndef SHIM_AVR_CPUFUNC_H
+#define SHIM_AVR_CPUFUNC_H
+
+#define _NOP()                  ((void) 0)
+#define _MemoryBarrier()        __asm__ __volatile__ ("" ::: "memory")
+
+#endif /* SHIM_AVR_CPUFUNC_H */
@@ -0,0 +1,31 @@
+/* Host shim of <avr/eeprom.h>: EEMEM variables are ordinary memory */
+
+#ifndef SHIM_AVR_EEPROM_H
+#define SHIM_AVR_EEPROM_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+#define EEMEM
+
+/* NOTE: Destination of the last write, lets tests damage stored data */
+extern void *shim_eeprom_last_write;
+
+static inline void eeprom_read_block(void *dst, const void *src, size_t n)
+{
+        memcpy(dst, src, n);
+}
+
+static inline void eeprom_write_block(const void *src, void *dst, size_t n)
+{
+        memcpy(dst, src, n);
+        shim_eeprom_last_write = dst;
+}
+
+static inline void eeprom_update_block(const void *src, void *dst, size_t n)
+{
+        eeprom_write_block(src, dst, n);
+}
+
+#endif /* SHIM_AVR_EEPROM_H */
@@ -0,0 +1,15 @@
+/* Host shim of <avr/interrupt.h>: ISRs become plain functions tests can call */
+
+#ifndef SHIM_AVR_INTERRUPT_H
+#define SHIM_AVR_INTERRUPT_H
+
+#include <avr/io.h>
+
+#define ISR(vector, ...)        void vector(void); void vector(void)
+#define ISR_NOBLOCK
+#define ISR_NAKED
+
+#define cli()                   ((void) 0)
+#define sei()                   ((void) 0)
+
+#endif /* SHIM_AVR_INTERRUPT_H */
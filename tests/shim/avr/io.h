@@ -0,0 +1,170 @@
+/*
+ * Host shim of <avr/io.h> for unit tests.
+ *
+ * I/O registers of ATmega2560 are bytes of shim_io[] at their real data space addresses,
+ * so tables of register pointers and the PINx/DDRx/PORTx layout behave like on target.
+ */
+
+#ifndef SHIM_AVR_IO_H
+#define SHIM_AVR_IO_H
+
+#include <stdint.h>
+
+#define SHIM_IO_SIZE 0x200
+
+extern volatile uint8_t shim_io[SHIM_IO_SIZE];
+
+#define _SFR_MEM8(addr)         (shim_io[(addr)])
+#define _SFR_MEM16(addr)        (*(volatile uint16_t *) &shim_io[(addr)])
+#define _BV(bit)                (1u << (bit))
+
+#define RAMSTART        0x200
+#define RAMEND          0x21ff
+#define E2END           0xfff
+
+#define PINA    _SFR_MEM8(0x20)
+#define DDRA    _SFR_MEM8(0x21)
+#define PORTA   _SFR_MEM8(0x22)
+#define PINB    _SFR_MEM8(0x23)
+#define DDRB    _SFR_MEM8(0x24)
+#define PORTB   _SFR_MEM8(0x25)
+#define PINC    _SFR_MEM8(0x26)
+#define DDRC    _SFR_MEM8(0x27)
+#define PORTC   _SFR_MEM8(0x28)
+#define PIND    _SFR_MEM8(0x29)
+#define DDRD    _SFR_MEM8(0x2a)
+#define PORTD   _SFR_MEM8(0x2b)
+#define PINE    _SFR_MEM8(0x2c)
+#define DDRE    _SFR_MEM8(0x2d)
+#define PORTE   _SFR_MEM8(0x2e)
+#define PINF    _SFR_MEM8(0x2f)
+#define DDRF    _SFR_MEM8(0x30)
+#define PORTF   _SFR_MEM8(0x31)
+#define PING    _SFR_MEM8(0x32)
+#define DDRG    _SFR_MEM8(0x33)
+#define PORTG   _SFR_MEM8(0x34)
+#define PINH    _SFR_MEM8(0x100)
+#define DDRH    _SFR_MEM8(0x101)
+#define PORTH   _SFR_MEM8(0x102)
+#define PINJ    _SFR_MEM8(0x103)
+#define DDRJ    _SFR_MEM8(0x104)
+#define PORTJ   _SFR_MEM8(0x105)
+#define PINK    _SFR_MEM8(0x106)
+#define DDRK    _SFR_MEM8(0x107)
+#define PORTK   _SFR_MEM8(0x108)
+#define PINL    _SFR_MEM8(0x109)
+#define DDRL    _SFR_MEM8(0x10a)
+#define PORTL   _SFR_MEM8(0x10b)
+
+#define TIFR0   _SFR_MEM8(0x35)
+#define TIFR1   _SFR_MEM8(0x36)
+#define PCIFR   _SFR_MEM8(0x3b)
+#define EIFR    _SFR_MEM8(0x3c)
+#define EIMSK   _SFR_MEM8(0x3d)
+#define GPIOR0  _SFR_MEM8(0x3e)
+#define EECR    _SFR_MEM8(0x3f)
+#define EEDR    _SFR_MEM8(0x40)
+#define EEAR    _SFR_MEM16(0x41)
+#define TCCR0A  _SFR_MEM8(0x44)
+#define TCCR0B  _SFR_MEM8(0x45)
+#define TCNT0   _SFR_MEM8(0x46)
+#define OCR0A   _SFR_MEM8(0x47)
+#define MCUSR   _SFR_MEM8(0x54)
+#define SP      _SFR_MEM16(0x5d)
+#define SREG    _SFR_MEM8(0x5f)
+#define WDTCSR  _SFR_MEM8(0x60)
+#define PCICR   _SFR_MEM8(0x68)
+#define EICRA   _SFR_MEM8(0x69)
+#define EICRB   _SFR_MEM8(0x6a)
+#define PCMSK0  _SFR_MEM8(0x6b)
+#define PCMSK1  _SFR_MEM8(0x6c)
+#define PCMSK2  _SFR_MEM8(0x6d)
+#define TIMSK0  _SFR_MEM8(0x6e)
+#define TIMSK1  _SFR_MEM8(0x6f)
+#define TCCR1A  _SFR_MEM8(0x80)
+#define TCCR1B  _SFR_MEM8(0x81)
+#define TCCR1C  _SFR_MEM8(0x82)
+#define TCNT1   _SFR_MEM16(0x84)
+#define ICR1    _SFR_MEM16(0x86)
+#define OCR1A   _SFR_MEM16(0x88)
+
+#define UCSR0A  _SFR_MEM8(0xc0)
+#define UCSR0B  _SFR_MEM8(0xc1)
+#define UCSR0C  _SFR_MEM8(0xc2)
+#define UBRR0L  _SFR_MEM8(0xc4)
+#define UBRR0H  _SFR_MEM8(0xc5)
+#define UDR0    _SFR_MEM8(0xc6)
+#define UCSR1A  _SFR_MEM8(0xc8)
+#define UCSR1B  _SFR_MEM8(0xc9)
+#define UCSR1C  _SFR_MEM8(0xca)
+#define UBRR1L  _SFR_MEM8(0xcc)
+#define UBRR1H  _SFR_MEM8(0xcd)
+#define UDR1    _SFR_MEM8(0xce)
+#define UCSR2A  _SFR_MEM8(0xd0)
+#define UCSR2B  _SFR_MEM8(0xd1)
+#define UCSR2C  _SFR_MEM8(0xd2)
+#define UBRR2L  _SFR_MEM8(0xd4)
+#define UBRR2H  _SFR_MEM8(0xd5)
+#define UDR2    _SFR_MEM8(0xd6)
+#define UCSR3A  _SFR_MEM8(0x130)
+#define UCSR3B  _SFR_MEM8(0x131)
+#define UCSR3C  _SFR_MEM8(0x132)
+#define UBRR3L  _SFR_MEM8(0x134)
+#define UBRR3H  _SFR_MEM8(0x135)
+#define UDR3    _SFR_MEM8(0x136)
+
+/* UCSRnA */
+#define RXC0    7
+#define TXC0    6
+#define UDRE0   5
+#define FE0     4
+#define DOR0    3
+#define UPE0    2
+
+/* UCSRnB */
+#define RXCIE0  7
+#define TXCIE0  6
+#define UDRIE0  5
+#define RXEN0   4
+#define TXEN0   3
+
+/* UCSRnC */
+#define USBS0   3
+#define UCSZ01  2
+#define UCSZ00  1
+
+/* Timers */
+#define CS00    0
+#define CS01    1
+#define CS02    2
+#define CS10    0
+#define CS11    1
+#define CS12    2
+#define WGM01   1
+#define OCIE0A  1
+#define TOV0    0
+#define TOV1    0
+#define ICIE1   5
+#define ICES1   6
+#define ICNC1   7
+
+/* External and pin change interrupts */
+#define ISC00   0
+#define ISC01   1
+#define PCIE0   0
+#define PCIE1   1
+#define PCIE2   2
+
+/* MCUSR, WDTCSR */
+#define PORF    0
+#define EXTRF   1
+#define BORF    2
+#define WDRF    3
+#define JTRF    4
+#define WDE     3
+#define WDCE    4
+#define WDIE    6
+
+#define SREG_I  7
+
+#endif /* SHIM_AVR_IO_H */
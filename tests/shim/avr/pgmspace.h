@@ -0,0 +1,45 @@
+/* Host shim of <avr/pgmspace.h>: flash is ordinary memory */
+
+#ifndef SHIM_AVR_PGMSPACE_H
+#define SHIM_AVR_PGMSPACE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <stdio.h>
+
+#define PROGMEM
+#define PSTR(s)                 (s)
+
+#define SHIM_PGM_READ(type, addr)                                               \
+        ({                                                                      \
+                type _value;                                                    \
+                memcpy(&_value, (const void *) (addr), sizeof(type));           \
+                _value;                                                         \
+        })
+
+#define pgm_read_byte(addr)     SHIM_PGM_READ(uint8_t, addr)
+#define pgm_read_word(addr)     SHIM_PGM_READ(uint16_t, addr)
+#define pgm_read_dword(addr)    SHIM_PGM_READ(uint32_t, addr)
+#define pgm_read_ptr(addr)      SHIM_PGM_READ(void *, addr)
+
+#define pgm_read_byte_near(addr)        pgm_read_byte(addr)
+#define pgm_read_word_near(addr)        pgm_read_word(addr)
+#define pgm_read_dword_near(addr)       pgm_read_dword(addr)
+
+#define memcpy_P        memcpy
+#define strncpy_P       strncpy
+#define strcmp_P        strcmp
+#define strstr_P        strstr
+#define strchr_P        strchr
+#define sscanf_P        sscanf
+#define printf_P        printf
+
+/* NOTE: avr-libc stdio extensions, streams set up this way are never used on host */
+#define _FDEV_EOF               (-2)
+#define _FDEV_SETUP_READ        1
+#define _FDEV_SETUP_WRITE       2
+
+#define FDEV_SETUP_STREAM(put, get, rwflag) { 0 }
+
+#endif /* SHIM_AVR_PGMSPACE_H */
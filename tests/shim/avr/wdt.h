@@ -0,0 +1,13 @@
+/* Host shim of <avr/wdt.h> */
+
+#ifndef SHIM_AVR_WDT_H
+#define SHIM_AVR_WDT_H
+
+#define WDTO_15MS       0
+#define WDTO_2S         7
+
+#define wdt_enable(timeout)     ((void) (timeout))
+#define wdt_disable()           ((void) 0)
+#define wdt_reset()             ((void) 0)
+
+#endif /* SHIM_AVR_WDT_H */
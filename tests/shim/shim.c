@@ -0,0 +1,6 @@
+#include <avr/io.h>
+#include <avr/eeprom.h>
+
+volatile uint8_t shim_io[SHIM_IO_SIZE];
+
+void *shim_eeprom_last_write = NULL;
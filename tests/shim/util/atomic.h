@@ -0,0 +1,11 @@
+/* Host shim of <util/atomic.h>: tests are single threaded, ISRs are called directly */
+
+#ifndef SHIM_UTIL_ATOMIC_H
+#define SHIM_UTIL_ATOMIC_H
+
+#define ATOMIC_RESTORESTATE
+#define ATOMIC_FORCEON
+
+#define ATOMIC_BLOCK(type) for (int _shim_atomic = 1; _shim_atomic; _shim_atomic = 0)
+
+#endif /* SHIM_UTIL_ATOMIC_H */
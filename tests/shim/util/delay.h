@@ -0,0 +1,9 @@
+/* Host shim of <util/delay.h> */
+
+#ifndef SHIM_UTIL_DELAY_H
+#define SHIM_UTIL_DELAY_H
+
+static inline void _delay_us(double usecs) { (void) usecs; }
+static inline void _delay_ms(double msecs) { (void) msecs; }
+
+#endif /* SHIM_UTIL_DELAY_H */
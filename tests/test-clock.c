@@ -0,0 +1,71 @@
+#include "unittest.h"
+#include "clock.h"
+#include "timer.h"
+
+/* NOTE: Timer0 compare match ISR is a plain function in host build, one call is 1 ms */
+void TIMER0_COMPA_vect(void);
+
+static void tick(unsigned long msecs)
+{
+        for (; msecs > 0ul; --msecs)
+                TIMER0_COMPA_vect();
+}
+
+TEST(clock_counts_milliseconds)
+{
+        struct clock_time start;
+        struct clock_time now;
+
+
+        clock_get_time(&start);
+        tick(1500ul);
+        clock_get_time(&now);
+
+        CHECK_EQ(clock_get_msecs() - (start.sec * 1000ul + start.msec), 1500);
+        CHECK(now.msec < 1000ul);
+        CHECK_EQ(clock_diff(&now, &start), 1500.0);
+}
+
+TEST(clock_cmp_orders_times)
+{
+        struct clock_time a = { 1ul, 500ul };
+        struct clock_time b = { 1ul, 700ul };
+        struct clock_time c = { 2ul, 0ul };
+
+
+        /* NOTE: clock_cmp() returns 1 when the first time is earlier */
+        CHECK_EQ(clock_cmp(&a, &b), 1);
+        CHECK_EQ(clock_cmp(&b, &a), -1);
+        CHECK_EQ(clock_cmp(&b, &c), 1);
+        CHECK_EQ(clock_cmp(&c, &a), -1);
+        CHECK_EQ(clock_cmp(&a, &a), 0);
+}
+
+TEST(timer_expires_after_interval)
+{
+        struct timer t;
+
+
+        timer_set_msecs(&t, 250ul);
+        CHECK(!timer_expired(&t));
+
+        tick(250ul);
+        CHECK(!timer_expired(&t));
+        CHECK_EQ(timer_remaining(&t), 0.0);
+
+        tick(1ul);
+        CHECK(timer_expired(&t));
+
+        timer_reset(&t);
+        CHECK(!timer_expired(&t));
+        CHECK_EQ(timer_remaining(&t), 250.0);
+}
+
+int main(void)
+{
+        RUN_TEST(clock_counts_milliseconds);
+        RUN_TEST(clock_cmp_orders_times);
+        RUN_TEST(timer_expires_after_interval);
+
+        return unittest_report();
+}
@@ -0,0 +1,104 @@
+#include "unittest.h"
+#include <avr/eeprom.h>
+#include <avr/pgmspace.h>
+
+#include "config.h"
+
+TEST(defaults_are_parsed)
+{
+        struct config cfg;
+
+
+        config_load_defaults(&cfg);
+
+        CHECK_EQ(cfg.version, CONFIG_VERSION);
+        CHECK_EQ(cfg.console.dev_num, 0);
+        CHECK_EQ(cfg.console.baud_rate, 115200ul);
+        CHECK_EQ(cfg.console.frame_size, 8);
+        CHECK_EQ(cfg.console.parity_sign, 'N');
+        CHECK_EQ(cfg.console.n_stop_bits, 1);
+
+        CHECK_EQ(cfg.modbus.uart.dev_num, 1);
+        CHECK_EQ(cfg.modbus.uart.baud_rate, 9600ul);
+        CHECK_EQ(cfg.modbus.de_port.port_letter, 'L');
+        CHECK_EQ(cfg.modbus.de_port.bit, 0);
+
+        CHECK_EQ(cfg.dht_port.port_letter, 'B');
+        CHECK_EQ(cfg.dht_port.bit, 4);
+}
+
+TEST(erased_eeprom_is_rejected)
+{
+        struct config cfg;
+
+
+        /* NOTE: EEMEM block is zero filled in host build, never written yet */
+        CHECK(!config_load(&cfg));
+        CHECK_EQ(config_get_source(), CONFIG_SOURCE_DEFAULTS);
+        CHECK_EQ(config_get()->console.baud_rate, 115200ul);
+}
+
+TEST(save_and_load)
+{
+        struct config saved;
+        struct config loaded;
+
+
+        config_load_defaults(&saved);
+        saved.console.baud_rate = 57600ul;
+        CHECK(modbus_rtu_parse_params(&saved.modbus, "uart=UART2:19200@8N1"));
+
+        config_save(&saved);
+
+        CHECK(config_load(&loaded));
+        CHECK_MEM_EQ(&loaded, &saved, sizeof(struct config));
+        CHECK_EQ(loaded.modbus.uart.dev_num, 2);
+        CHECK_EQ(loaded.modbus.de_port.port_letter, '\0');
+}
+
+TEST(damaged_block_is_rejected)
+{
+        struct config cfg;
+        uint8_t *stored = NULL;
+
+
+        config_load_defaults(&cfg);
+        config_save(&cfg);
+        CHECK(config_load(&cfg));
+
+        stored = (uint8_t *) shim_eeprom_last_write;
+
+        /* Flipped bit in settings */
+        stored[offsetof(struct config, console)] ^= 0x01u;
+        CHECK(!config_load(&cfg));
+        stored[offsetof(struct config, console)] ^= 0x01u;
+        CHECK(config_load(&cfg));
+
+        /* Layout of other firmware version */
+        stored[offsetof(struct config, version)]++;
+        CHECK(!config_load(&cfg));
+}
+
+TEST(bad_params_are_rejected)
+{
+        struct modbus_rtu_params modbus;
+        struct uart_params uart;
+        struct gpio_params gpio;
+
+
+        CHECK(!uart_parse_params(&uart, "UART0:115200"));
+        CHECK(!gpio_parse_params(&gpio, "PORTB:8"));
+        CHECK(!modbus_rtu_parse_params(&modbus, "de_port=PORTL:0"));
+        CHECK(!modbus_rtu_parse_params(&modbus, "uart=UART1:9600@8N1,speed=fast"));
+}
+
+int main(void)
+{
+        RUN_TEST(defaults_are_parsed);
+        RUN_TEST(erased_eeprom_is_rejected);
+        RUN_TEST(save_and_load);
+        RUN_TEST(damaged_block_is_rejected);
+        RUN_TEST(bad_params_are_rejected);
+
+        return unittest_report();
+}
@@ -0,0 +1,49 @@
+#include "unittest.h"
+#include "crc16.h"
+
+TEST(check_value)
+{
+        uint16_t crc_reg = CRC16_REG_INITIALIZER;
+
+
+        /* CRC-16/MODBUS check value */
+        crc16_update(&crc_reg, "123456789", 9u);
+        CHECK_EQ(crc_reg, 0x4b37);
+}
+
+TEST(modbus_request)
+{
+        static uint8_t const req[] = { 0x01, 0x03, 0x00, 0x00, 0x00, 0x0a };
+        uint16_t crc_reg = CRC16_REG_INITIALIZER;
+
+
+        /* Sent on the wire low byte first: 0xc5 0xcd */
+        crc16_update(&crc_reg, req, sizeof(req));
+        CHECK_EQ(crc_reg, 0xcdc5);
+}
+
+TEST(chain_equals_contiguous)
+{
+        static char text[] = "123456789";
+        struct mem_chunk chunks[3];
+        struct mem_chain chain;
+        uint16_t crc_reg = CRC16_REG_INITIALIZER;
+
+
+        mem_chunk_set(&chunks[0], &text[0], 2u);
+        mem_chunk_set(&chunks[1], &text[2], 0u);
+        mem_chunk_set(&chunks[2], &text[2], 7u);
+        mem_chain_init(&chain, chunks, 3u);
+
+        crc16_update_chain(&crc_reg, &chain);
+        CHECK_EQ(crc_reg, 0x4b37);
+}
+
+int main(void)
+{
+        RUN_TEST(check_value);
+        RUN_TEST(modbus_request);
+        RUN_TEST(chain_equals_contiguous);
+
+        return unittest_report();
+}
@@ -0,0 +1,74 @@
+#include "unittest.h"
+#include "fifo-buffer.h"
+
+TEST(empty_after_init)
+{
+        struct fifo_buffer fifo;
+        uint8_t mem[4];
+        uint8_t byte = 0u;
+
+
+        fifo_buffer_init(&fifo, mem, sizeof(mem));
+
+        CHECK(fifo_buffer_is_empty(&fifo));
+        CHECK(!fifo_buffer_is_full(&fifo));
+        CHECK_EQ(fifo_buffer_get_unused_size(&fifo), 4);
+        CHECK(!fifo_buffer_get_byte(&fifo, &byte));
+}
+
+TEST(put_until_full)
+{
+        struct fifo_buffer fifo;
+        uint8_t mem[4];
+        uint8_t i = 0u;
+
+
+        fifo_buffer_init(&fifo, mem, sizeof(mem));
+
+        for (; i < 4u; ++i)
+                CHECK(fifo_buffer_put_byte(&fifo, i));
+
+        CHECK(fifo_buffer_is_full(&fifo));
+        CHECK(!fifo_buffer_put_byte(&fifo, 0xffu));
+        CHECK_EQ(fifo_buffer_get_size(&fifo), 4);
+}
+
+TEST(order_is_kept_across_wrap)
+{
+        struct fifo_buffer fifo;
+        uint8_t mem[3];
+        uint8_t byte = 0u;
+        uint8_t next_put = 0u;
+        uint8_t next_get = 0u;
+        int round = 0;
+
+
+        fifo_buffer_init(&fifo, mem, sizeof(mem));
+
+        /* Keep the buffer partly filled so offsets wrap many times */
+        for (; round < 100; ++round) {
+                while (fifo_buffer_put_byte(&fifo, next_put))
+                        next_put++;
+
+                CHECK(fifo_buffer_get_byte(&fifo, &byte));
+                CHECK_EQ(byte, next_get++);
+
+                CHECK(fifo_buffer_get_byte(&fifo, &byte));
+                CHECK_EQ(byte, next_get++);
+        }
+
+        while (fifo_buffer_get_byte(&fifo, &byte))
+                CHECK_EQ(byte, next_get++);
+
+        CHECK_EQ(next_get, next_put);
+        CHECK(fifo_buffer_is_empty(&fifo));
+}
+
+int main(void)
+{
+        RUN_TEST(empty_after_init);
+        RUN_TEST(put_until_full);
+        RUN_TEST(order_is_kept_across_wrap);
+
+        return unittest_report();
+}
@@ -0,0 +1,135 @@
+#include <stdlib.h>
+
+#include "unittest.h"
+#include "frame.h"
+
+static enum frame_decoder_result push_all(struct frame_decoder *dec, const struct mem_chunk *encoded,
+                                          struct frame *frame)
+{
+        enum frame_decoder_result result = FRAME_DECODER_INCOMPLETE;
+        size_t i = 0u;
+
+
+        for (; i < encoded->size; ++i) {
+                result = frame_decoder_push(dec, ((const uint8_t *) encoded->ptr)[i], frame);
+                if (result != FRAME_DECODER_INCOMPLETE)
+                        break;
+        }
+
+
+        return result;
+}
+
+TEST(round_trip)
+{
+        struct frame_encoder enc;
+        struct frame_decoder dec;
+        struct frame frame;
+        struct mem_chunk out;
+        uint8_t buf[FRAME_MAX_ENCODED_SIZE];
+        uint8_t payload[FRAME_MAX_PAYLOAD_SIZE];
+        size_t size = 0u;
+        size_t i = 0u;
+        int round = 0;
+
+
+        frame_encoder_init(&enc);
+        frame_decoder_init(&dec);
+        srand(1);
+
+        for (; round < 1000; ++round) {
+                size = (size_t) rand() % (FRAME_MAX_PAYLOAD_SIZE + 1);
+
+                /* NOTE: Every other round is mostly zeros to exercise COBS blocks */
+                for (i = 0u; i < size; ++i)
+                        payload[i] = (round % 2 == 0) ? (uint8_t) rand() : (uint8_t) (rand() % 3 == 0);
+
+                mem_chunk_set(&out, buf, sizeof(buf));
+                CHECK(frame_encode(&enc, FRAME_TYPE_SAMPLES, payload, size, &out));
+                CHECK(memchr(buf, FRAME_DELIMITER, out.size - 1u) == NULL);
+                CHECK_EQ(buf[out.size - 1u], FRAME_DELIMITER);
+
+                CHECK_EQ(push_all(&dec, &out, &frame), FRAME_DECODER_OK);
+                CHECK_EQ(frame.type, FRAME_TYPE_SAMPLES);
+                CHECK_EQ(frame.payload_size, size);
+                CHECK_MEM_EQ(frame.payload, payload, size);
+        }
+
+        CHECK_EQ(dec.n_frames, 1000);
+        CHECK_EQ(dec.n_errors, 0);
+        CHECK_EQ(dec.n_lost, 0);
+}
+
+TEST(chain_equals_contiguous)
+{
+        struct frame_encoder enc;
+        struct mem_chunk out;
+        struct mem_chunk chunks[2];
+        struct mem_chain chain;
+        uint8_t buf[2][FRAME_MAX_ENCODED_SIZE];
+        size_t size = 0u;
+        char text[] = "telemetry";
+
+
+        frame_encoder_init(&enc);
+        mem_chunk_set(&out, buf[0], sizeof(buf[0]));
+        CHECK(frame_encode(&enc, FRAME_TYPE_TELEMETRY, text, 9u, &out));
+        size = out.size;
+
+        /* NOTE: Sequence number is part of the frame, so start over from the same one */
+        frame_encoder_init(&enc);
+        mem_chunk_set(&chunks[0], &text[0], 4u);
+        mem_chunk_set(&chunks[1], &text[4], 5u);
+        mem_chain_init(&chain, chunks, 2u);
+        mem_chunk_set(&out, buf[1], sizeof(buf[1]));
+        CHECK(frame_encode_chain(&enc, FRAME_TYPE_TELEMETRY, &chain, &out));
+
+        CHECK_EQ(out.size, size);
+        CHECK_MEM_EQ(buf[1], buf[0], size);
+}
+
+TEST(corrupted_and_lost_frames)
+{
+        struct frame_encoder enc;
+        struct frame_decoder dec;
+        struct frame frame;
+        struct mem_chunk out;
+        uint8_t buf[FRAME_MAX_ENCODED_SIZE];
+
+
+        frame_encoder_init(&enc);
+        frame_decoder_init(&dec);
+
+        mem_chunk_set(&out, buf, sizeof(buf));
+        CHECK(frame_encode(&enc, FRAME_TYPE_LOG, "abc", 3u, &out));
+        buf[3] ^= 0x01u;
+        CHECK_EQ(push_all(&dec, &out, &frame), FRAME_DECODER_CRC_ERROR);
+
+        /* Next frame decodes fine, the corrupted one counts as lost */
+        mem_chunk_set(&out, buf, sizeof(buf));
+        CHECK(frame_encode(&enc, FRAME_TYPE_LOG, "abc", 3u, &out));
+        CHECK_EQ(push_all(&dec, &out, &frame), FRAME_DECODER_OK);
+        CHECK_EQ(dec.n_errors, 1);
+}
+
+TEST(output_too_small)
+{
+        struct frame_encoder enc;
+        struct mem_chunk out;
+        uint8_t buf[5];
+
+
+        frame_encoder_init(&enc);
+        mem_chunk_set(&out, buf, sizeof(buf));
+        CHECK(!frame_encode(&enc, FRAME_TYPE_LOG, "abc", 3u, &out));
+}
+
+int main(void)
+{
+        RUN_TEST(round_trip);
+        RUN_TEST(chain_equals_contiguous);
+        RUN_TEST(corrupted_and_lost_frames);
+        RUN_TEST(output_too_small);
+
+        return unittest_report();
+}
@@ -0,0 +1,90 @@
+#include "unittest.h"
+#include <avr/io.h>
+
+#include "gpio-intr.h"
+
+/* NOTE: Timer0 compare match and INT4 ISRs are plain functions in host build */
+void TIMER0_COMPA_vect(void);
+void INT4_vect(void);
+
+static void tick(unsigned long msecs)
+{
+        for (; msecs > 0ul; --msecs)
+                TIMER0_COMPA_vect();
+}
+
+static void edge(void)
+{
+        PINE ^= (uint8_t) _BV(4);
+        INT4_vect();
+}
+
+TEST(debounce_survives_take_count)
+{
+        struct gpio port;
+        struct gpio_intr intr;
+        struct gpio_event event;
+
+
+        CHECK(gpio_init(&port, "PORTE:4"));
+        gpio_intr_init(&intr, NULL, NULL);
+        CHECK(gpio_intr_attach(&intr, &port, GPIO_EDGE_ANY, 50u));
+        CHECK_EQ(DDRE & _BV(4), 0);
+
+        tick(100ul);
+        edge();
+        CHECK_EQ(gpio_intr_take_count(&intr), 1);
+
+        /* Bounce right after the count is drained */
+        tick(10ul);
+        edge();
+        CHECK_EQ(gpio_intr_get_count(&intr), 0);
+
+        tick(60ul);
+        edge();
+        CHECK_EQ(gpio_intr_get_count(&intr), 1);
+
+        CHECK(gpio_intr_get_event(&event));
+        CHECK(event.intr == &intr);
+        CHECK(gpio_intr_get_event(&event));
+        CHECK(!gpio_intr_get_event(&event));
+
+        gpio_intr_detach(&intr);
+}
+
+TEST(source_is_attached_once)
+{
+        struct gpio port;
+        struct gpio other_port;
+        struct gpio_intr first;
+        struct gpio_intr second;
+        struct gpio_intr other;
+
+
+        CHECK(gpio_init(&port, "PORTE:5"));
+        CHECK(gpio_init(&other_port, "PORTE:6"));
+        gpio_intr_init(&first, NULL, NULL);
+        gpio_intr_init(&second, NULL, NULL);
+        gpio_intr_init(&other, NULL, NULL);
+
+        /* NOTE: Free slot ahead of the taken one must not hide it */
+        CHECK(gpio_intr_attach(&other, &other_port, GPIO_EDGE_ANY, 0u));
+        CHECK(gpio_intr_attach(&first, &port, GPIO_EDGE_ANY, 0u));
+        gpio_intr_detach(&other);
+
+        DDRE |= (uint8_t) _BV(5);
+        CHECK(!gpio_intr_attach(&second, &port, GPIO_EDGE_ANY, 0u));
+        CHECK_EQ(DDRE & _BV(5), _BV(5));
+
+        gpio_intr_detach(&first);
+        CHECK(gpio_intr_attach(&second, &port, GPIO_EDGE_ANY, 0u));
+        gpio_intr_detach(&second);
+}
+
+int main(void)
+{
+        RUN_TEST(debounce_survives_take_count);
+        RUN_TEST(source_is_attached_once);
+
+        return unittest_report();
+}
@@ -0,0 +1,200 @@
+#include "unittest.h"
+#include <avr/io.h>
+#include <avr/pgmspace.h>
+
+#include "json-writer.h"
+
+/* NOTE: UART ISRs are plain functions in host build */
+void USART1_UDRE_vect(void);
+
+static void write_to_chunk(char *buf, size_t size, void (*write)(struct json_writer *),
+                           bool is_ok)
+{
+        struct json_writer w;
+        struct mem_chunk chunk;
+
+
+        mem_chunk_set(&chunk, buf, size);
+        json_writer_init_chunk(&w, &chunk);
+
+        write(&w);
+
+        CHECK_EQ(json_writer_finish(&w), is_ok);
+}
+
+TEST(nested_document)
+{
+        struct json_writer w;
+        struct mem_chunk chunk;
+        char buf[96];
+
+
+        mem_chunk_set(&chunk, buf, sizeof(buf));
+        json_writer_init_chunk(&w, &chunk);
+
+        json_writer_begin_object(&w);
+        json_writer_key_P(&w, PSTR("t"));
+        json_writer_fixed(&w, -215, 1u);
+        json_writer_key_P(&w, PSTR("ok"));
+        json_writer_bool(&w, true);
+        json_writer_key_P(&w, PSTR("v"));
+        json_writer_begin_array(&w);
+        json_writer_int(&w, -1);
+        json_writer_uint(&w, 4294967295ul);
+        json_writer_null(&w);
+        json_writer_string(&w, "a\"b");
+        json_writer_end_array(&w);
+        json_writer_end_object(&w);
+
+        CHECK(json_writer_finish(&w));
+        CHECK_STR_EQ(buf, "{\"t\":-21.5,\"ok\":true,\"v\":[-1,4294967295,null,\"a\\\"b\"]}");
+}
+
+TEST(overflow_fails)
+{
+        struct json_writer w;
+        struct mem_chunk chunk;
+        char buf[8];
+
+
+        mem_chunk_set(&chunk, buf, sizeof(buf));
+        json_writer_init_chunk(&w, &chunk);
+
+        json_writer_begin_array(&w);
+        json_writer_string(&w, "too long for buffer");
+        json_writer_end_array(&w);
+
+        CHECK(!json_writer_finish(&w));
+}
+
+static void write_uart_document(struct json_writer *w)
+{
+        json_writer_begin_object(w);
+        json_writer_key_P(w, PSTR("t"));
+        json_writer_fixed(w, -5, 1u);
+        json_writer_end_object(w);
+}
+
+TEST(uart_sink)
+{
+        static char const expected[] = "{\"t\":-0.5}";
+        struct uart dev;
+        struct json_writer w;
+        char sent[sizeof(expected)];
+        size_t n_sent = 0u;
+
+
+        CHECK(uart_setup_P(&dev, PSTR("UART1:115200@8N1")));
+
+        /* NOTE: Data register is busy, so every byte stays in TX FIFO until UDRE interrupt */
+        UCSR1A = (uint8_t) 0u;
+
+        json_writer_init_uart(&w, &dev);
+        write_uart_document(&w);
+
+        CHECK_EQ(fifo_buffer_get_size(&dev.hw->tx_fifo), sizeof(expected) - 1u);
+        CHECK(json_writer_finish(&w));
+        CHECK((UCSR1B & _BV(UDRIE0)) != 0u);
+
+        while ((UCSR1B & _BV(UDRIE0)) != 0u && n_sent < sizeof(sent) - 1u) {
+                USART1_UDRE_vect();
+                sent[n_sent++] = (char) UDR1;
+        }
+
+        sent[n_sent] = '\0';
+        CHECK_STR_EQ(sent, expected);
+
+        /* Interrupt finds FIFO empty and stops itself */
+        USART1_UDRE_vect();
+        CHECK_EQ(UCSR1B & _BV(UDRIE0), 0u);
+}
+
+static void write_max_depth(struct json_writer *w)
+{
+        uint8_t i = 0u;
+
+
+        for (; i < JSON_WRITER_MAX_DEPTH - 1u; ++i)
+                json_writer_begin_array(w);
+
+        for (i = 0u; i < JSON_WRITER_MAX_DEPTH - 1u; ++i)
+                json_writer_end_array(w);
+}
+
+static void write_past_max_depth(struct json_writer *w)
+{
+        uint8_t i = 0u;
+
+
+        for (; i < JSON_WRITER_MAX_DEPTH; ++i)
+                json_writer_begin_array(w);
+
+        for (i = 0u; i < JSON_WRITER_MAX_DEPTH; ++i)
+                json_writer_end_array(w);
+}
+
+static void write_unbalanced(struct json_writer *w)
+{
+        json_writer_begin_object(w);
+        json_writer_end_object(w);
+        json_writer_end_object(w);
+}
+
+TEST(depth_limit)
+{
+        char buf[32];
+
+
+        write_to_chunk(buf, sizeof(buf), write_max_depth, true);
+        CHECK_STR_EQ(buf, "[[[[[[[]]]]]]]");
+
+        write_to_chunk(buf, sizeof(buf), write_past_max_depth, false);
+        write_to_chunk(buf, sizeof(buf), write_unbalanced, false);
+}
+
+static void write_control_chars(struct json_writer *w)
+{
+        json_writer_string(w, "\x01" "a\tb\r\n\x1f\\");
+}
+
+TEST(control_chars_are_escaped)
+{
+        char buf[48];
+
+
+        write_to_chunk(buf, sizeof(buf), write_control_chars, true);
+        CHECK_STR_EQ(buf, "\"\\u0001a\\tb\\r\\n\\u001f\\\\\"");
+}
+
+static void write_fractions(struct json_writer *w)
+{
+        json_writer_begin_array(w);
+        json_writer_fixed(w, -5, 1u);
+        json_writer_fixed(w, -5, 2u);
+        json_writer_fixed(w, -99, 2u);
+        json_writer_fixed(w, 7, 3u);
+        json_writer_fixed(w, 0, 1u);
+        json_writer_fixed(w, -2147483647l - 1l, 2u);
+        json_writer_end_array(w);
+}
+
+TEST(fixed_below_one)
+{
+        char buf[64];
+
+
+        write_to_chunk(buf, sizeof(buf), write_fractions, true);
+        CHECK_STR_EQ(buf, "[-0.5,-0.05,-0.99,0.007,0.0,-21474836.48]");
+}
+
+int main(void)
+{
+        RUN_TEST(nested_document);
+        RUN_TEST(overflow_fails);
+        RUN_TEST(uart_sink);
+        RUN_TEST(depth_limit);
+        RUN_TEST(control_chars_are_escaped);
+        RUN_TEST(fixed_below_one);
+
+        return unittest_report();
+}
@@ -0,0 +1,116 @@
+#include "unittest.h"
+#include "mem-chunk.h"
+
+static char text[] = "hello, world";
+
+static void make_chain(struct mem_chain *chain, struct mem_chunk *chunks)
+{
+        /* "hello" + "" + ", " + "world" */
+        mem_chunk_set(&chunks[0], &text[0], 5u);
+        mem_chunk_set(&chunks[1], &text[5], 0u);
+        mem_chunk_set(&chunks[2], &text[5], 2u);
+        mem_chunk_set(&chunks[3], &text[7], 5u);
+
+        mem_chain_init(chain, chunks, 4u);
+}
+
+static size_t chain_to_string(struct mem_chain *chain, char *buf)
+{
+        struct mem_chunk *chunk = NULL;
+        size_t size = 0u;
+
+
+        MEM_CHAIN_FOREACH(chain, chunk) {
+                memcpy(&buf[size], chunk->ptr, chunk->size);
+                size += chunk->size;
+        }
+
+        buf[size] = '\0';
+
+
+        return size;
+}
+
+TEST(chunk_slice_from_offset)
+{
+        struct mem_chunk base;
+        struct mem_chunk slice;
+
+
+        mem_chunk_set(&base, text, strlen(text));
+        base.offset = 7u;
+
+        CHECK(mem_chunk_slice_from_offset(&base, &slice, 5u));
+        CHECK(slice.ptr == &text[7]);
+        CHECK_EQ(slice.size, 5);
+        CHECK_EQ(slice.offset, 0);
+
+        CHECK(!mem_chunk_slice_from_offset(&base, &slice, 6u));
+}
+
+TEST(chain_sizes)
+{
+        struct mem_chunk chunks[4];
+        struct mem_chain chain;
+
+
+        make_chain(&chain, chunks);
+
+        CHECK_EQ(mem_chain_get_size(&chain), 12);
+        CHECK_EQ(mem_chain_get_remaining(&chain), 12);
+        CHECK(!mem_chain_is_completed(&chain));
+
+        chunks[0].offset = 5u;
+        chain.index = 1u;
+        CHECK_EQ(mem_chain_get_remaining(&chain), 7);
+
+        mem_chain_rewind(&chain);
+        CHECK_EQ(chunks[0].offset, 0);
+        CHECK_EQ(chain.index, 0);
+}
+
+TEST(chain_slice_every_range)
+{
+        struct mem_chunk chunks[4];
+        struct mem_chunk slice_chunks[4];
+        struct mem_chain chain;
+        struct mem_chain slice;
+        char buf[16];
+        size_t offset = 0u;
+        size_t size = 0u;
+
+
+        make_chain(&chain, chunks);
+
+        for (; offset <= 12u; ++offset) {
+                for (size = 0u; offset + size <= 12u; ++size) {
+                        CHECK(mem_chain_slice(&chain, offset, size, &slice, slice_chunks, 4u));
+                        CHECK_EQ(chain_to_string(&slice, buf), size);
+                        CHECK(memcmp(buf, &text[offset], size) == 0);
+                }
+        }
+}
+
+TEST(chain_slice_out_of_bounds)
+{
+        struct mem_chunk chunks[4];
+        struct mem_chunk slice_chunks[4];
+        struct mem_chain chain;
+        struct mem_chain slice;
+
+
+        make_chain(&chain, chunks);
+
+        CHECK(!mem_chain_slice(&chain, 10u, 3u, &slice, slice_chunks, 4u));
+        CHECK(!mem_chain_slice(&chain, 0u, 12u, &slice, slice_chunks, 2u));
+}
+
+int main(void)
+{
+        RUN_TEST(chunk_slice_from_offset);
+        RUN_TEST(chain_sizes);
+        RUN_TEST(chain_slice_every_range);
+        RUN_TEST(chain_slice_out_of_bounds);
+
+        return unittest_report();
+}
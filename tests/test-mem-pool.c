@@ -0,0 +1,75 @@
+#include "unittest.h"
+#include "mem-pool.h"
+
+MEM_POOL_DEFINE(test_pool, 5, 3);
+MEM_ARENA_DEFINE(test_arena, 32);
+
+TEST(pool_exhaust_and_reuse)
+{
+        struct mem_pool_stats stats;
+        void *blocks[3] = { NULL, };
+        void *block = NULL;
+        int i = 0;
+
+
+        for (; i < 3; ++i) {
+                CHECK((blocks[i] = mem_pool_alloc(&test_pool)) != NULL);
+                CHECK_EQ((size_t) blocks[i] % MEM_ALIGN, 0);
+        }
+
+        CHECK(blocks[0] != blocks[1] && blocks[1] != blocks[2]);
+        CHECK(mem_pool_alloc(&test_pool) == NULL);
+
+        /* Freed block is the next one handed out */
+        mem_pool_free(&test_pool, blocks[1]);
+        CHECK((block = mem_pool_alloc(&test_pool)) == blocks[1]);
+
+        mem_pool_get_stats(&test_pool, &stats);
+        CHECK_EQ(stats.n_blocks, 3);
+        CHECK_EQ(stats.n_used, 3);
+        CHECK_EQ(stats.max_used, 3);
+        CHECK_EQ(stats.n_failures, 1);
+        CHECK(stats.block_size >= 5u);
+
+        for (i = 0; i < 3; ++i)
+                mem_pool_free(&test_pool, blocks[i]);
+
+        mem_pool_get_stats(&test_pool, &stats);
+        CHECK_EQ(stats.n_used, 0);
+        CHECK_EQ(stats.max_used, 3);
+}
+
+TEST(arena_mark_and_release)
+{
+        size_t mark = 0u;
+        uint8_t *a = NULL;
+        uint8_t *b = NULL;
+
+
+        mem_arena_reset(&test_arena);
+
+        CHECK((a = (uint8_t *) mem_arena_alloc(&test_arena, 3u)) != NULL);
+        mark = mem_arena_get_mark(&test_arena);
+
+        CHECK((b = (uint8_t *) mem_arena_alloc(&test_arena, 8u)) != NULL);
+        CHECK(b >= a + 3);
+        CHECK_EQ((size_t) b % MEM_ALIGN, 0);
+
+        mem_arena_release(&test_arena, mark);
+        CHECK(mem_arena_alloc(&test_arena, 8u) == b);
+
+        CHECK(mem_arena_alloc(&test_arena, 64u) == NULL);
+        CHECK_EQ(test_arena.n_failures, 1);
+
+        mem_arena_reset(&test_arena);
+        CHECK(mem_arena_alloc(&test_arena, 3u) == a);
+        CHECK(test_arena.max_used > 3u);
+}
+
+int main(void)
+{
+        RUN_TEST(pool_exhaust_and_reuse);
+        RUN_TEST(arena_mark_and_release);
+
+        return unittest_report();
+}
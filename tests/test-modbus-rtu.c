@@ -0,0 +1,273 @@
+#include "unittest.h"
+#include <avr/pgmspace.h>
+
+#include "modbus-rtu.h"
+#include "crc16.h"
+
+/* NOTE: UART ISRs are plain functions in host build */
+void USART1_RX_vect(void);
+void USART1_UDRE_vect(void);
+
+static struct modbus_rtu rtu;
+
+static void feed(const uint8_t *bytes, size_t size)
+{
+        size_t i = 0u;
+
+
+        for (; i < size; ++i) {
+                UDR1 = bytes[i];
+                USART1_RX_vect();
+        }
+}
+
+static void feed_with_crc(const uint8_t *bytes, size_t size)
+{
+        uint16_t crc_reg = CRC16_REG_INITIALIZER;
+        uint8_t crc[2];
+
+
+        crc16_update(&crc_reg, bytes, size);
+        crc[0] = (uint8_t) (crc_reg & 0xffu);
+        crc[1] = (uint8_t) (crc_reg >> 8);
+
+        feed(bytes, size);
+        feed(crc, sizeof(crc));
+}
+
+TEST(send_request)
+{
+        struct modbus_req req;
+        uint8_t const addr[2] = { 0x00, 0x00 };
+
+
+        /* NOTE: Data register is always empty and transmission is always complete */
+        UCSR1A = (uint8_t) (_BV(UDRE0) | _BV(TXC0));
+
+        modbus_req_clear(&req);
+        req.slave_addr = 0x01u;
+        req.func_code = MODBUS_FUNC_READ_HOLDING_REGISTERS;
+        req.data = addr;
+        req.data_size = sizeof(addr);
+        req.quantity = 10u;
+
+        modbus_rtu_send_sync(&rtu, &req);
+
+        /* 01 03 00 00 00 0a c5 cd, high byte of CRC goes last */
+        CHECK_EQ(req.crc, 0xcdc5);
+        CHECK_EQ(UDR1, 0xcd);
+
+        UCSR1A = (uint8_t) 0u;
+}
+
+TEST(recv_sync)
+{
+        static uint8_t const resp_bytes[] = { 0x01, 0x03, 0x04, 0x00, 0x0a, 0x00, 0x0b };
+        struct modbus_resp resp;
+
+
+        feed_with_crc(resp_bytes, sizeof(resp_bytes));
+
+        modbus_resp_clear(&resp);
+        CHECK_EQ(modbus_rtu_recv_sync(&rtu, &resp), MODBUS_RESULT_OK);
+        CHECK_EQ(resp.slave_addr, 0x01);
+        CHECK_EQ(resp.func_code, MODBUS_FUNC_READ_HOLDING_REGISTERS);
+        CHECK_EQ(resp.data_size, 4);
+        CHECK_MEM_EQ(resp.data, &resp_bytes[3], 4u);
+}
+
+TEST(recv_async_byte_by_byte)
+{
+        static uint8_t const resp_bytes[] = { 0x11, 0x04, 0x02, 0x12, 0x34 };
+        uint16_t crc_reg = CRC16_REG_INITIALIZER;
+        uint8_t crc[2];
+        struct modbus_rtu_async *async = NULL;
+        size_t i = 0u;
+
+
+        crc16_update(&crc_reg, resp_bytes, sizeof(resp_bytes));
+        crc[0] = (uint8_t) (crc_reg & 0xffu);
+        crc[1] = (uint8_t) (crc_reg >> 8);
+
+        CHECK((async = modbus_rtu_async_alloc()) != NULL);
+        CHECK_EQ(modbus_rtu_recv_async(&rtu, async), MODBUS_RESULT_INCOMPLETE);
+
+        /* State machine must make progress however the bytes are split */
+        for (; i < sizeof(resp_bytes); ++i) {
+                feed(&resp_bytes[i], 1u);
+                CHECK_EQ(modbus_rtu_recv_async(&rtu, async), MODBUS_RESULT_INCOMPLETE);
+        }
+
+        feed(&crc[0], 1u);
+        CHECK_EQ(modbus_rtu_recv_async(&rtu, async), MODBUS_RESULT_INCOMPLETE);
+        feed(&crc[1], 1u);
+        CHECK_EQ(modbus_rtu_recv_async(&rtu, async), MODBUS_RESULT_OK);
+
+        CHECK(modbus_rtu_async_is_completed(async));
+        CHECK_EQ(async->resp.slave_addr, 0x11);
+        CHECK_EQ(async->resp.data_size, 2);
+        CHECK_MEM_EQ(async->resp.data, &resp_bytes[3], 2u);
+
+        modbus_rtu_async_free(async);
+}
+
+TEST(recv_async_exception)
+{
+        static uint8_t const resp_bytes[] = { 0x01, 0x83, MODBUS_EXCEPT_ILLEGAL_DATA_ADDR };
+        struct modbus_rtu_async *async = NULL;
+
+
+        CHECK((async = modbus_rtu_async_alloc()) != NULL);
+
+        feed_with_crc(resp_bytes, sizeof(resp_bytes));
+        while (modbus_rtu_recv_async(&rtu, async) == MODBUS_RESULT_INCOMPLETE)
+                ;
+
+        CHECK_EQ(async->result, MODBUS_RESULT_OK);
+        CHECK(modbus_resp_is_exception(&async->resp));
+        CHECK_EQ(async->resp.except_code, MODBUS_EXCEPT_ILLEGAL_DATA_ADDR);
+
+        modbus_rtu_async_free(async);
+}
+
+TEST(recv_async_errors)
+{
+        static uint8_t const bad_crc[] = { 0x01, 0x03, 0x02, 0x00, 0x01, 0x00, 0x00 };
+        static uint8_t const too_long[] = { 0x01, 0x03, MODBUS_RESP_DATA_SIZE };
+        struct modbus_rtu_async *async = NULL;
+
+
+        CHECK((async = modbus_rtu_async_alloc()) != NULL);
+
+        feed(bad_crc, sizeof(bad_crc));
+        while (modbus_rtu_recv_async(&rtu, async) == MODBUS_RESULT_INCOMPLETE)
+                ;
+
+        CHECK_EQ(async->result, MODBUS_RESULT_CRC_ERROR);
+
+        modbus_rtu_async_init(async);
+        feed(too_long, sizeof(too_long));
+        CHECK_EQ(modbus_rtu_recv_async(&rtu, async), MODBUS_RESULT_NOT_ENOUGH_MEMORY_ERROR);
+
+        modbus_rtu_async_free(async);
+}
+
+TEST(send_request_async)
+{
+        static uint8_t const expected[] = { 0x01, 0x03, 0x00, 0x00, 0x00, 0x0a, 0xc5, 0xcd };
+        struct modbus_req req;
+        uint8_t const addr[2] = { 0x00, 0x00 };
+        uint8_t sent[sizeof(expected)];
+        size_t i = 0u;
+
+
+        modbus_req_clear(&req);
+        req.slave_addr = 0x01u;
+        req.func_code = MODBUS_FUNC_READ_HOLDING_REGISTERS;
+        req.data = addr;
+        req.data_size = sizeof(addr);
+        req.quantity = 10u;
+
+        modbus_rtu_send_async(&rtu, &req);
+
+        /* NOTE: Request is queued, DE line is driven high by releasing it to the pullup */
+        CHECK(!modbus_rtu_send_is_completed(&rtu));
+        CHECK_EQ(DDRL & _BV(0), 0u);
+        CHECK((UCSR1B & _BV(UDRIE0)) != 0u);
+
+        /* Shim keeps TXC written by clear, real hardware clears it */
+        UCSR1A = (uint8_t) 0u;
+
+        for (; i < sizeof(sent); ++i) {
+                USART1_UDRE_vect();
+                sent[i] = UDR1;
+        }
+
+        CHECK_MEM_EQ(sent, expected, sizeof(expected));
+        CHECK(!modbus_rtu_send_is_completed(&rtu));
+
+        /* Last stop bit is out */
+        UCSR1A = (uint8_t) _BV(TXC0);
+        CHECK(modbus_rtu_send_is_completed(&rtu));
+        CHECK_EQ(DDRL & _BV(0), _BV(0));
+        CHECK_EQ(PORTL & _BV(0), 0u);
+
+        UCSR1A = (uint8_t) 0u;
+}
+
+TEST(send_without_de_port)
+{
+        struct modbus_rtu no_de;
+        struct modbus_req req;
+
+
+        CHECK(modbus_rtu_setup(&no_de, "uart=UART1:9600@8N1"));
+        CHECK(!gpio_is_usable(&no_de.enable_port));
+
+        UCSR1A = (uint8_t) (_BV(UDRE0) | _BV(TXC0));
+        DDRL = (uint8_t) 0u;
+        PORTL = (uint8_t) 0xffu;
+
+        modbus_req_clear(&req);
+        req.slave_addr = 0x01u;
+        req.func_code = MODBUS_FUNC_READ_HOLDING_REGISTERS;
+        req.quantity = 1u;
+
+        modbus_rtu_send_sync(&no_de, &req);
+
+        /* NOTE: Unconfigured DE port must not touch any pin */
+        CHECK_EQ(DDRL, 0u);
+        CHECK_EQ(PORTL, 0xffu);
+
+        UCSR1A = (uint8_t) 0u;
+        PORTL = (uint8_t) 0u;
+}
+
+TEST(console_uart_is_refused)
+{
+        struct modbus_rtu on_console;
+
+
+        UBRR0L = (uint8_t) 0x5au;
+
+        /* NOTE: Console is UART0 in default config */
+        CHECK(!modbus_rtu_setup(&on_console, "uart=UART0:9600@8N1"));
+        CHECK_EQ(UBRR0L, 0x5au);
+
+        UBRR0L = (uint8_t) 0u;
+}
+
+TEST(async_pool_limit)
+{
+        struct modbus_rtu_async *asyncs[MODBUS_RTU_MAX_TRANSACTIONS];
+        size_t i = 0u;
+
+
+        for (; i < MODBUS_RTU_MAX_TRANSACTIONS; ++i)
+                CHECK((asyncs[i] = modbus_rtu_async_alloc()) != NULL);
+
+        CHECK(modbus_rtu_async_alloc() == NULL);
+
+        for (i = 0u; i < MODBUS_RTU_MAX_TRANSACTIONS; ++i)
+                modbus_rtu_async_free(asyncs[i]);
+}
+
+int main(void)
+{
+        if (!modbus_rtu_setup_P(&rtu, PSTR("uart=UART1:9600@8N1,de_port=PORTL:0"))) {
+                fprintf(stderr, "Failed to set up ModBus RTU\n");
+                return 1;
+        }
+
+        RUN_TEST(send_request);
+        RUN_TEST(send_request_async);
+        RUN_TEST(recv_sync);
+        RUN_TEST(recv_async_byte_by_byte);
+        RUN_TEST(recv_async_exception);
+        RUN_TEST(recv_async_errors);
+        RUN_TEST(send_without_de_port);
+        RUN_TEST(console_uart_is_refused);
+        RUN_TEST(async_pool_limit);
+
+        return unittest_report();
+}
@@ -0,0 +1,74 @@
+/*
+ * Minimal unit test harness.
+ *
+ * Every test-*.c is a separate program: define tests with TEST(name), run them from
+ * main() with RUN_TEST(name) and finish with "return unittest_report();".
+ */
+
+#ifndef UNITTEST_H
+#define UNITTEST_H
+
+#include <stdio.h>
+#include <string.h>
+
+static const char *unittest_name = NULL;
+static unsigned unittest_n_checks = 0u;
+static unsigned unittest_n_failures = 0u;
+
+#define TEST(name) static void test_##name(void)
+
+#define RUN_TEST(name)                                                                  \
+        do {                                                                            \
+                unittest_name = #name;                                                  \
+                test_##name();                                                          \
+        } while (0)
+
+#define UNITTEST_FAIL(fmt, ...)                                                         \
+        do {                                                                            \
+                unittest_n_failures++;                                                  \
+                fprintf(stderr, "%s:%d: %s: " fmt "\n", __FILE__, __LINE__,             \
+                        unittest_name, __VA_ARGS__);                                    \
+        } while (0)
+
+#define CHECK(expr)                                                                     \
+        do {                                                                            \
+                unittest_n_checks++;                                                    \
+                if (!(expr))                                                            \
+                        UNITTEST_FAIL("check failed: %s", #expr);                       \
+        } while (0)
+
+#define CHECK_EQ(actual, expected)                                                      \
+        do {                                                                            \
+                long long _actual = (long long) (actual);                               \
+                long long _expected = (long long) (expected);                           \
+                                                                                        \
+                unittest_n_checks++;                                                    \
+                if (_actual != _expected)                                               \
+                        UNITTEST_FAIL("%s == %lld, expected %lld", #actual,             \
+                                      _actual, _expected);                              \
+        } while (0)
+
+#define CHECK_STR_EQ(actual, expected)                                                  \
+        do {                                                                            \
+                unittest_n_checks++;                                                    \
+                if (strcmp((actual), (expected)) != 0)                                  \
+                        UNITTEST_FAIL("%s == \"%s\", expected \"%s\"", #actual,         \
+                                      (actual), (expected));                            \
+        } while (0)
+
+#define CHECK_MEM_EQ(actual, expected, size)                                            \
+        do {                                                                            \
+                unittest_n_checks++;                                                    \
+                if (memcmp((actual), (expected), (size)) != 0)                          \
+                        UNITTEST_FAIL("%s differs from %s", #actual, #expected);        \
+        } while (0)
+
+static inline int unittest_report(void)
+{
+        printf("%s: %u checks, %u failures\n", __BASE_FILE__, unittest_n_checks, unittest_n_failures);
+
+
+        return unittest_n_failures == 0u ? 0 : 1;
+}
+
+#endif /* UNITTEST_H */
@@ -0,0 +1,72 @@
+/*
+ * Host side decoder for binary frames (see frame.h).
+ *
+ * Usage: frame-dump [FILE]
+ *
+ * Reads COBS framed stream from FILE (serial device or capture) or from stdin
+ * and prints every frame as one line: sequence number, type, payload size and hex dump.
+ * Serial port must be configured beforehand, e.g. "stty -F /dev/ttyUSB0 115200 raw".
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+#include "frame.h"
+
+static void print_frame(const struct frame *frame)
+{
+        size_t i = 0u;
+
+
+        printf("seq=%u type=0x%02x size=%zu:", frame->seq, frame->type, frame->payload_size);
+
+        for (; i < frame->payload_size; ++i)
+                printf(" %02x", frame->payload[i]);
+
+        printf("\n");
+        fflush(stdout);
+}
+
+int main(int argc, char **argv)
+{
+        FILE *input = stdin;
+        struct frame_decoder dec;
+        struct frame frame;
+        enum frame_decoder_result result = FRAME_DECODER_INCOMPLETE;
+        int ch = 0;
+
+
+        if (argc > 2) {
+                fprintf(stderr, "usage: %s [FILE]\n", argv[0]);
+                return EXIT_FAILURE;
+        }
+
+        if (argc == 2 && (input = fopen(argv[1], "rb")) == NULL) {
+                fprintf(stderr, "%s: %s\n", argv[1], strerror(errno));
+                return EXIT_FAILURE;
+        }
+
+        frame_decoder_init(&dec);
+
+        while ((ch = fgetc(input)) != EOF) {
+                result = frame_decoder_push(&dec, (uint8_t) ch, &frame);
+
+                if (result == FRAME_DECODER_OK)
+                        print_frame(&frame);
+                else if (result == FRAME_DECODER_CRC_ERROR)
+                        fprintf(stderr, "// CRC error\n");
+                else if (result == FRAME_DECODER_FORMAT_ERROR)
+                        fprintf(stderr, "// Malformed frame\n");
+        }
+
+        fprintf(stderr, "// %lu frames, %lu errors, %lu lost\n",
+                dec.n_frames, dec.n_errors, dec.n_lost);
+
+        if (input != stdin)
+                fclose(input);
+
+
+        return EXIT_SUCCESS;
+}
@@ -0,0 +1,368 @@
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <poll.h>
+#include <termios.h>
+#include <unistd.h>
+
+#include "host-uart.h"
+#include "serial.h"
+
+#define FLAG_IS_SET(mask, flag) (((mask) & (flag)) == (flag))
+
+struct host_uart_device {
+        const char *path;
+        int fd;
+};
+
+/* NOTE: FIFOs of uart_hw batch bytes between system calls */
+static struct uart_hw hw_devices[HOST_UART_N_DEVICES];
+static struct host_uart_device host_devices[HOST_UART_N_DEVICES];
+
+static struct host_uart_device *get_host_device(struct uart *dev)
+{
+        return &host_devices[dev->hw->index];
+}
+
+bool host_uart_bind(unsigned dev_num, const char *path)
+{
+        if (dev_num >= HOST_UART_N_DEVICES)
+                return false;
+
+        host_devices[dev_num].path = path;
+        host_devices[dev_num].fd = -1;
+
+
+        return true;
+}
+
+int host_uart_get_fd(struct uart *dev)
+{
+        return get_host_device(dev)->fd;
+}
+
+bool host_uart_wait(struct uart *dev, int timeout_msecs)
+{
+        struct pollfd pfd;
+
+
+        if (!fifo_buffer_is_empty(&dev->hw->rx_fifo))
+                return true;
+
+        pfd.fd = host_uart_get_fd(dev);
+        pfd.events = POLLIN;
+
+
+        return poll(&pfd, 1, timeout_msecs) > 0;
+}
+
+void host_uart_discard_input(struct uart *dev)
+{
+        uint8_t byte = 0u;
+
+
+        tcflush(host_uart_get_fd(dev), TCIFLUSH);
+
+        while (fifo_buffer_get_byte(&dev->hw->rx_fifo, &byte))
+                ;
+}
+
+bool uart_parse_params(struct uart_params *params, const char *str)
+{
+        unsigned dev_num = 0u;
+        unsigned long baud_rate = 0u;
+        unsigned frame_size = 0u;
+        char parity_sign = 0;
+        unsigned n_stop_bits = 0u;
+
+
+        memset(params, 0, sizeof(struct uart_params));
+
+        if (sscanf(str, "UART%u:%lu@%u%c%u", &dev_num, &baud_rate, &frame_size,
+                   &parity_sign, &n_stop_bits) != 5) {
+
+                return false;
+        }
+
+        if (dev_num > 0xffu || frame_size > 0xffu || n_stop_bits > 0xffu)
+                return false;
+
+        params->baud_rate = (uint32_t) baud_rate;
+        params->dev_num = (uint8_t) dev_num;
+        params->frame_size = (uint8_t) frame_size;
+        params->parity_sign = parity_sign;
+        params->n_stop_bits = (uint8_t) n_stop_bits;
+
+
+        return true;
+}
+
+bool uart_parse_params_P(struct uart_params *params, const char *str)
+{
+        return uart_parse_params(params, str);
+}
+
+bool uart_setup_params(struct uart *dev, const struct uart_params *params)
+{
+        struct host_uart_device *host = NULL;
+        struct uart_hw *hw = NULL;
+
+
+        memset(dev, 0, sizeof(struct uart));
+
+        /* NOTE: Only 8N1 is supported by serial helpers */
+        if (params->dev_num >= HOST_UART_N_DEVICES || params->frame_size != 8u
+                        || params->parity_sign != 'N' || params->n_stop_bits != 1u) {
+
+                return false;
+        }
+
+        host = &host_devices[params->dev_num];
+        if (host->path == NULL)
+                return false;
+
+        if (host->fd >= 0)
+                close(host->fd);
+
+        if ((host->fd = serial_open(host->path, params->baud_rate)) < 0) {
+                fprintf(stderr, "// %s: %s\n", host->path, strerror(errno));
+                return false;
+        }
+
+        hw = &hw_devices[params->dev_num];
+        fifo_buffer_init(&hw->tx_fifo, hw->_tx_fifo_buf, sizeof(hw->_tx_fifo_buf));
+        fifo_buffer_init(&hw->rx_fifo, hw->_rx_fifo_buf, sizeof(hw->_rx_fifo_buf));
+        memset(&hw->stats, 0, sizeof(struct uart_stats));
+        hw->index = params->dev_num;
+
+        dev->hw = hw;
+
+
+        return true;
+}
+
+bool uart_setup(struct uart *dev, const char *params)
+{
+        struct uart_params parsed;
+
+
+        memset(dev, 0, sizeof(struct uart));
+
+        if (!uart_parse_params(&parsed, params))
+                return false;
+
+
+        return uart_setup_params(dev, &parsed);
+}
+
+bool uart_setup_P(struct uart *dev, const char *params)
+{
+        return uart_setup(dev, params);
+}
+
+int uart_poll(struct uart *dev, int event_mask)
+{
+        int revents = 0;
+
+
+        if (FLAG_IS_SET(event_mask, UART_POLL_IN) && host_uart_wait(dev, 0))
+                revents |= UART_POLL_IN;
+
+        if (FLAG_IS_SET(event_mask, UART_POLL_OUT))
+                revents |= UART_POLL_OUT;
+
+
+        return revents;
+}
+
+void uart_flush(struct uart *dev)
+{
+        uint8_t buf[UART_HW_TX_FIFO_SIZE];
+        size_t size = 0u;
+        int fd = -1;
+
+
+        fd = host_uart_get_fd(dev);
+
+        while (fifo_buffer_get_byte(&dev->hw->tx_fifo, &buf[size]))
+                size++;
+
+        if (size > 0u && write(fd, buf, size) != (ssize_t) size)
+                dev->hw->stats.n_dropped++;
+}
+
+static bool fill_rx_fifo(struct uart *dev, int flags)
+{
+        uint8_t buf[UART_HW_RX_FIFO_SIZE];
+        ssize_t n = 0;
+        ssize_t i = 0;
+
+
+        do {
+                if (!FLAG_IS_SET(flags, UART_FLAG_NONBLOCK))
+                        host_uart_wait(dev, -1);
+
+                n = read(host_uart_get_fd(dev), buf,
+                         fifo_buffer_get_unused_size(&dev->hw->rx_fifo));
+
+        } while (n <= 0 && !FLAG_IS_SET(flags, UART_FLAG_NONBLOCK));
+
+        for (; i < n; ++i)
+                fifo_buffer_put_byte(&dev->hw->rx_fifo, buf[i]);
+
+
+        return n > 0;
+}
+
+enum uart_result uart_read_byte(struct uart *dev, uint8_t *store, int flags)
+{
+        if (fifo_buffer_is_empty(&dev->hw->rx_fifo) && !fill_rx_fifo(dev, flags))
+                return UART_RESULT_WILL_BLOCK;
+
+        fifo_buffer_get_byte(&dev->hw->rx_fifo, store);
+
+        /* Translate CR to LF on input */
+        if (FLAG_IS_SET(flags, UART_FLAG_TEXT_MODE) && *store == '\r')
+                *store = (uint8_t) '\n';
+
+
+        return UART_RESULT_OK;
+}
+
+enum uart_result uart_write_byte(struct uart *dev, uint8_t byte, int flags)
+{
+        if (FLAG_IS_SET(flags, UART_FLAG_TEXT_MODE) && (int) byte == '\n')
+                uart_write_byte(dev, (uint8_t) '\r', flags & ~UART_FLAG_TEXT_MODE);
+
+        if (fifo_buffer_is_full(&dev->hw->tx_fifo))
+                uart_flush(dev);
+
+        fifo_buffer_put_byte(&dev->hw->tx_fifo, byte);
+
+
+        return UART_RESULT_OK;
+}
+
+static enum uart_result read_bytes(struct uart *dev, struct mem_chunk *chunk, int flags)
+{
+        size_t i = 0u;
+        uint8_t *bytes = NULL;
+        enum uart_result result = UART_RESULT_OK;
+
+
+        i = chunk->offset;
+        bytes = (uint8_t *) chunk->ptr;
+
+        for (; i < chunk->size; ++i) {
+                result = uart_read_byte(dev, &bytes[i], flags);
+                if (result != UART_RESULT_OK)
+                        break;
+        }
+
+
+        chunk->offset = i;
+        return result;
+}
+
+static void write_bytes(struct uart *dev, struct mem_chunk *chunk, int flags)
+{
+        size_t i = 0u;
+        uint8_t *bytes = NULL;
+
+
+        i = chunk->offset;
+        bytes = (uint8_t *) chunk->ptr;
+
+        for (; i < chunk->size; ++i)
+                uart_write_byte(dev, bytes[i], flags);
+
+        chunk->offset = i;
+}
+
+static void write_done(struct uart *dev, int flags)
+{
+        uart_flush(dev);
+
+        /* NOTE: Synchronous output returns when the last stop bit has left the line */
+        if (FLAG_IS_SET(flags, UART_FLAG_SYNC_TXC))
+                tcdrain(host_uart_get_fd(dev));
+}
+
+enum uart_result uart_read_chunk(struct uart *dev, struct mem_chunk *chunk, int flags)
+{
+        return read_bytes(dev, chunk, flags);
+}
+
+enum uart_result uart_write_chunk(struct uart *dev, struct mem_chunk *chunk, int flags)
+{
+        write_bytes(dev, chunk, flags);
+        write_done(dev, flags);
+
+
+        return UART_RESULT_OK;
+}
+
+enum uart_result uart_read_chain(struct uart *dev, struct mem_chain *chain, int flags)
+{
+        enum uart_result result = UART_RESULT_OK;
+
+
+        for (; chain->index < chain->n_chunks; ++chain->index) {
+                result = read_bytes(dev, &chain->chunks[chain->index], flags);
+                if (result != UART_RESULT_OK)
+                        break;
+        }
+
+
+        return result;
+}
+
+enum uart_result uart_write_chain(struct uart *dev, struct mem_chain *chain, int flags)
+{
+        /* NOTE: Chunks are batched into as few writes as TX FIFO allows */
+        for (; chain->index < chain->n_chunks; ++chain->index)
+                write_bytes(dev, &chain->chunks[chain->index], flags);
+
+        write_done(dev, flags);
+
+
+        return UART_RESULT_OK;
+}
+
+void uart_clear_tx_complete(struct uart *dev)
+{
+        (void) dev;
+}
+
+bool uart_is_tx_complete(struct uart *dev)
+{
+        write_done(dev, UART_FLAG_SYNC_TXC);
+
+
+        return true;
+}
+
+void uart_get_stats(struct uart *dev, struct uart_stats *stats)
+{
+        *stats = dev->hw->stats;
+}
+
+void uart_clear_stats(struct uart *dev)
+{
+        memset(&dev->hw->stats, 0, sizeof(struct uart_stats));
+}
+
+void uart_bind_to_cstdin(struct uart *dev)
+{
+        (void) dev;
+}
+
+void uart_bind_to_cstdout(struct uart *dev)
+{
+        (void) dev;
+}
+
+void uart_bind_to_cstderr(struct uart *dev)
+{
+        (void) dev;
+}
@@ -0,0 +1,52 @@
+/*
+ * Copyright (c) 2018 Sereda Anton
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ */
+
+#ifndef HOST_UART_H
+#define HOST_UART_H
+
+#include <stdbool.h>
+
+#include "uart.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * NOTE: Host implementation of uart.h API over POSIX serial devices, so firmware modules
+ *       run unchanged in host tools. Device is bound to UART number before uart_setup(),
+ *       which then opens it with baud rate from parameters string.
+ */
+
+#define HOST_UART_N_DEVICES 4
+
+bool host_uart_bind(unsigned dev_num, const char *path);
+int host_uart_get_fd(struct uart *dev);
+bool host_uart_wait(struct uart *dev, int timeout_msecs);
+void host_uart_discard_input(struct uart *dev);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* HOST_UART_H */
@@ -0,0 +1,301 @@
+/*
+ * Host side decoder for deferred-format log records (see log.h).
+ *
+ * Usage: log-decode FIRMWARE.ELF [FILE]
+ *
+ * Reads COBS framed stream from FILE or stdin, picks FRAME_TYPE_LOG frames, looks up
+ * format strings by their flash address in FIRMWARE.ELF and prints formatted lines.
+ * Arguments are decoded with AVR type sizes: int is 2 bytes, long is 4 bytes.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <elf.h>
+
+#include "frame.h"
+
+#define TARGET_INT_SIZE         2u
+#define TARGET_LONG_SIZE        4u
+#define FORMAT_SPEC_SIZE        32
+
+struct firmware {
+        uint8_t *image;
+        size_t image_size;
+
+        const Elf32_Shdr *sections;
+        size_t n_sections;
+};
+
+static bool firmware_load(struct firmware *fw, const char *path)
+{
+        FILE *file = NULL;
+        long size = 0;
+        const Elf32_Ehdr *ehdr = NULL;
+
+
+        memset(fw, 0, sizeof(struct firmware));
+
+        if ((file = fopen(path, "rb")) == NULL) {
+                fprintf(stderr, "%s: %s\n", path, strerror(errno));
+                return false;
+        }
+
+        if (fseek(file, 0, SEEK_END) != 0 || (size = ftell(file)) <= 0 || fseek(file, 0, SEEK_SET) != 0) {
+                fclose(file);
+                return false;
+        }
+
+        fw->image_size = (size_t) size;
+        fw->image = malloc(fw->image_size);
+
+        if (fw->image == NULL || fread(fw->image, 1, fw->image_size, file) != fw->image_size) {
+                fclose(file);
+                return false;
+        }
+
+        fclose(file);
+
+        ehdr = (const Elf32_Ehdr *) fw->image;
+        if (fw->image_size < sizeof(Elf32_Ehdr) || memcmp(ehdr->e_ident, ELFMAG, SELFMAG) != 0
+                        || ehdr->e_ident[EI_CLASS] != ELFCLASS32
+                        || ehdr->e_shoff + (size_t) ehdr->e_shnum * sizeof(Elf32_Shdr) > fw->image_size) {
+
+                fprintf(stderr, "%s: not a 32-bit ELF file\n", path);
+                return false;
+        }
+
+        fw->sections = (const Elf32_Shdr *) (fw->image + ehdr->e_shoff);
+        fw->n_sections = ehdr->e_shnum;
+
+
+        return true;
+}
+
+static const char *firmware_lookup_string(struct firmware *fw, uint16_t addr)
+{
+        const Elf32_Shdr *shdr = NULL;
+        size_t i = 0u;
+        size_t offset = 0u;
+
+
+        /* NOTE: Flash addresses of AVR live below 0x800000, RAM sections are above it */
+        for (; i < fw->n_sections; ++i) {
+                shdr = &fw->sections[i];
+
+                if (shdr->sh_type != SHT_PROGBITS || (shdr->sh_flags & SHF_ALLOC) == 0u)
+                        continue;
+
+                if (addr < shdr->sh_addr || addr >= shdr->sh_addr + shdr->sh_size)
+                        continue;
+
+                offset = shdr->sh_offset + (addr - shdr->sh_addr);
+                if (offset >= fw->image_size || memchr(fw->image + offset, '\0', fw->image_size - offset) == NULL)
+                        return NULL;
+
+                return (const char *) (fw->image + offset);
+        }
+
+
+        return NULL;
+}
+
+static bool take_uint(const uint8_t **args, const uint8_t *end, size_t size, unsigned long *value)
+{
+        size_t i = 0u;
+
+
+        if ((size_t) (end - *args) < size)
+                return false;
+
+        *value = 0ul;
+        for (; i < size; ++i)
+                *value |= (unsigned long) (*args)[i] << (8u * i);
+
+        *args += size;
+
+
+        return true;
+}
+
+static bool take_string(const uint8_t **args, const uint8_t *end, const char **str)
+{
+        const uint8_t *nul = NULL;
+
+
+        if ((nul = memchr(*args, '\0', (size_t) (end - *args))) == NULL)
+                return false;
+
+        *str = (const char *) *args;
+        *args = nul + 1;
+
+
+        return true;
+}
+
+static bool print_record(const char *fmt, const uint8_t *args, const uint8_t *end)
+{
+        char spec[FORMAT_SPEC_SIZE];
+        size_t spec_len = 0u;
+        unsigned long value = 0ul;
+        const char *str = NULL;
+        bool is_long = false;
+
+
+        while (*fmt != '\0') {
+                if (*fmt != '%') {
+                        putchar(*fmt++);
+                        continue;
+                }
+
+                spec_len = 0u;
+                spec[spec_len++] = *fmt++;
+                is_long = false;
+
+                while (*fmt != '\0' && strchr("-+ #0123456789.*", *fmt) != NULL && spec_len < FORMAT_SPEC_SIZE - 4u) {
+                        if (*fmt == '*') {
+                                if (!take_uint(&args, end, TARGET_INT_SIZE, &value))
+                                        return false;
+
+                                spec_len += (size_t) snprintf(&spec[spec_len], FORMAT_SPEC_SIZE - spec_len,
+                                                              "%d", (int) (int16_t) value);
+                                fmt++;
+                        } else
+                                spec[spec_len++] = *fmt++;
+                }
+
+                if (*fmt == 'l') {
+                        is_long = true;
+                        fmt++;
+                }
+
+                spec[spec_len++] = 'l';
+                spec[spec_len++] = *fmt;
+                spec[spec_len] = '\0';
+
+                switch (*fmt) {
+                case 'd':
+                case 'i':
+                        if (!take_uint(&args, end, is_long ? TARGET_LONG_SIZE : TARGET_INT_SIZE, &value))
+                                return false;
+
+                        printf(spec, is_long ? (long) (int32_t) value : (long) (int16_t) value);
+                        break;
+
+                case 'u':
+                case 'x':
+                case 'X':
+                case 'o':
+                        if (!take_uint(&args, end, is_long ? TARGET_LONG_SIZE : TARGET_INT_SIZE, &value))
+                                return false;
+
+                        printf(spec, value);
+                        break;
+
+                case 'c':
+                        if (!take_uint(&args, end, TARGET_INT_SIZE, &value))
+                                return false;
+
+                        spec[spec_len - 2u] = 'c';
+                        spec[spec_len - 1u] = '\0';
+                        printf(spec, (int) (value & 0xffu));
+                        break;
+
+                case 's':
+                case 'S':
+                        if (!take_string(&args, end, &str))
+                                return false;
+
+                        spec[spec_len - 2u] = 's';
+                        spec[spec_len - 1u] = '\0';
+                        printf(spec, str);
+                        break;
+
+                case '%':
+                        putchar('%');
+                        break;
+
+                default:
+                        return false;
+                }
+
+                if (*fmt != '\0')
+                        fmt++;
+        }
+
+
+        return true;
+}
+
+static void decode_frame(struct firmware *fw, const struct frame *frame)
+{
+        const uint8_t *args = NULL;
+        const uint8_t *end = NULL;
+        unsigned long addr = 0ul;
+        unsigned long msecs = 0ul;
+        const char *fmt = NULL;
+
+
+        if (frame->type != FRAME_TYPE_LOG)
+                return;
+
+        args = frame->payload;
+        end = frame->payload + frame->payload_size;
+
+        if (!take_uint(&args, end, 2u, &addr) || !take_uint(&args, end, 4u, &msecs)) {
+                fprintf(stderr, "// seq=%u: truncated log record\n", frame->seq);
+                return;
+        }
+
+        printf("[%lu.%03lu] ", msecs / 1000ul, msecs % 1000ul);
+
+        if ((fmt = firmware_lookup_string(fw, (uint16_t) addr)) == NULL) {
+                printf("<unknown format at 0x%04lx>\n", addr);
+                return;
+        }
+
+        if (!print_record(fmt, args, end))
+                printf(" <malformed arguments>");
+
+        printf("\n");
+        fflush(stdout);
+}
+
+int main(int argc, char **argv)
+{
+        struct firmware fw;
+        FILE *input = stdin;
+        struct frame_decoder dec;
+        struct frame frame;
+        int ch = 0;
+
+
+        if (argc < 2 || argc > 3) {
+                fprintf(stderr, "usage: %s FIRMWARE.ELF [FILE]\n", argv[0]);
+                return EXIT_FAILURE;
+        }
+
+        if (!firmware_load(&fw, argv[1]))
+                return EXIT_FAILURE;
+
+        if (argc == 3 && (input = fopen(argv[2], "rb")) == NULL) {
+                fprintf(stderr, "%s: %s\n", argv[2], strerror(errno));
+                return EXIT_FAILURE;
+        }
+
+        frame_decoder_init(&dec);
+
+        while ((ch = fgetc(input)) != EOF) {
+                if (frame_decoder_push(&dec, (uint8_t) ch, &frame) == FRAME_DECODER_OK)
+                        decode_frame(&fw, &frame);
+        }
+
+        if (input != stdin)
+                fclose(input);
+
+        free(fw.image);
+
+
+        return EXIT_SUCCESS;
+}
@@ -0,0 +1,300 @@
+/*
+ * Drives firmware ModBus RTU master (modbus-rtu.c built for host) against slaves on
+ * a serial line and reports throughput and latency distribution.
+ *
+ * Usage: modbus-load [OPTIONS] DEVICE
+ *
+ *      -b BAUD         baud rate (9600)
+ *      -a ADDR         address of the first slave (1)
+ *      -n N            number of slaves polled round-robin (1)
+ *      -f FUNC         function code, 3 or 4 (3)
+ *      -r REG          first register (0)
+ *      -q N            registers per request, 1..15 (10)
+ *      -t MSECS        response timeout (100)
+ *      -c N            number of transactions (1000)
+ *      -v              verify register values of modbus-slave-sim default map
+ *
+ * DEVICE is a pseudo-terminal printed by modbus-slave-sim or a real USB-RS485 adapter.
+ * Request is sent with modbus_rtu_send_sync() and response is polled with
+ * modbus_rtu_recv_async(), the way shell "modbus" command does it on the target.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "modbus-rtu.h"
+#include "host-uart.h"
+#include "serial.h"
+
+/* NOTE: Response data must fit MODBUS_RESP_DATA_SIZE with byte count below it */
+#define MAX_QUANTITY ((MODBUS_RESP_DATA_SIZE - 1) / 2)
+
+enum {
+        OUTCOME_OK = 0,
+        OUTCOME_EXCEPTION,
+        OUTCOME_CRC_ERROR,
+        OUTCOME_TIMEOUT,
+        OUTCOME_BAD_RESPONSE,
+
+        N_OUTCOMES
+};
+
+static const char *const outcome_names[N_OUTCOMES] = {
+        "ok", "exception", "crc", "timeout", "bad"
+};
+
+struct load_params {
+        unsigned long baud_rate;
+        unsigned first_addr;
+        unsigned n_slaves;
+        unsigned func_code;
+        unsigned start_reg;
+        unsigned quantity;
+        int timeout_msecs;
+        unsigned long n_transactions;
+        bool is_verify;
+};
+
+static int cmp_double(const void *a, const void *b)
+{
+        double x = *(const double *) a;
+        double y = *(const double *) b;
+
+
+        return (x > y) - (x < y);
+}
+
+static double percentile(const double *sorted, size_t n, unsigned p)
+{
+        size_t i = 0u;
+
+
+        if (n == 0u)
+                return 0.0;
+
+        i = (n * p + 99u) / 100u;
+        if (i > 0u)
+                i--;
+
+
+        return sorted[i];
+}
+
+static bool check_response(struct load_params *params, struct modbus_req *req,
+                           struct modbus_resp *resp)
+{
+        size_t i = 0u;
+        uint16_t value = 0u;
+        uint16_t expected = 0u;
+
+
+        if (resp->slave_addr != req->slave_addr || (resp->func_code & 0x7fu) != req->func_code)
+                return false;
+
+        if (modbus_resp_is_exception(resp))
+                return true;
+
+        if (resp->data_size != (size_t) req->quantity * 2u)
+                return false;
+
+        /* NOTE: Simulator registers default to (slave << 8 | register) */
+        for (; params->is_verify && i < req->quantity; ++i) {
+                value = (uint16_t) ((resp->data[2u * i] << 8) | resp->data[2u * i + 1u]);
+                expected = (uint16_t) ((req->slave_addr << 8) | ((params->start_reg + i) & 0xffu));
+
+                if (value != expected)
+                        return false;
+        }
+
+
+        return true;
+}
+
+static int transact(struct modbus_rtu *rtu, struct load_params *params, uint8_t slave_addr,
+                    double *latency)
+{
+        struct modbus_req req;
+        struct modbus_rtu_async *async = NULL;
+        enum modbus_result result = MODBUS_RESULT_INCOMPLETE;
+        uint8_t data[2];
+        double start = 0.0;
+        double now = 0.0;
+        int outcome = OUTCOME_TIMEOUT;
+
+
+        data[0] = (uint8_t) (params->start_reg >> 8);
+        data[1] = (uint8_t) (params->start_reg & 0xffu);
+
+        modbus_req_clear(&req);
+        req.slave_addr = slave_addr;
+        req.func_code = (uint8_t) params->func_code;
+        req.data = data;
+        req.data_size = sizeof(data);
+        req.quantity = (uint16_t) params->quantity;
+
+        if ((async = modbus_rtu_async_alloc()) == NULL)
+                return OUTCOME_BAD_RESPONSE;
+
+        start = serial_now_msecs();
+        modbus_rtu_send_sync(rtu, &req);
+
+        for (;;) {
+                result = modbus_rtu_recv_async(rtu, async);
+                if (result != MODBUS_RESULT_INCOMPLETE)
+                        break;
+
+                now = serial_now_msecs();
+                if (now - start >= (double) params->timeout_msecs)
+                        break;
+
+                host_uart_wait(&rtu->uart, (int) ((double) params->timeout_msecs - (now - start)) + 1);
+        }
+
+        *latency = serial_now_msecs() - start;
+
+        if (result == MODBUS_RESULT_OK) {
+                if (!check_response(params, &req, &async->resp))
+                        outcome = OUTCOME_BAD_RESPONSE;
+                else if (modbus_resp_is_exception(&async->resp))
+                        outcome = OUTCOME_EXCEPTION;
+                else
+                        outcome = OUTCOME_OK;
+
+        } else if (result == MODBUS_RESULT_CRC_ERROR)
+                outcome = OUTCOME_CRC_ERROR;
+        else if (result != MODBUS_RESULT_INCOMPLETE)
+                outcome = OUTCOME_BAD_RESPONSE;
+
+        modbus_rtu_async_free(async);
+
+
+        return outcome;
+}
+
+static void resync(struct modbus_rtu *rtu, unsigned long baud_rate)
+{
+        int gap_msecs = 0;
+
+
+        /* NOTE: Let the rest of a broken frame arrive and drop it, like the bus silence does */
+        gap_msecs = (int) (serial_char_msecs(baud_rate) * 3.5 + 1.0);
+
+        while (host_uart_wait(&rtu->uart, gap_msecs))
+                host_uart_discard_input(&rtu->uart);
+}
+
+static void print_report(struct load_params *params, unsigned long *counts, double *latencies,
+                         size_t n_latencies, double elapsed)
+{
+        size_t i = 0u;
+
+
+        qsort(latencies, n_latencies, sizeof(double), cmp_double);
+
+        printf("transactions: %lu in %.3f s, %.1f/s\n", params->n_transactions, elapsed / 1000.0,
+               (double) params->n_transactions * 1000.0 / elapsed);
+
+        for (; i < N_OUTCOMES; ++i)
+                printf("%s: %lu\n", outcome_names[i], counts[i]);
+
+        if (n_latencies > 0u) {
+                printf("latency ms (answered): min %.2f p50 %.2f p90 %.2f p99 %.2f max %.2f\n",
+                       latencies[0], percentile(latencies, n_latencies, 50u),
+                       percentile(latencies, n_latencies, 90u),
+                       percentile(latencies, n_latencies, 99u), latencies[n_latencies - 1u]);
+        }
+}
+
+int main(int argc, char **argv)
+{
+        struct load_params params;
+        struct modbus_rtu rtu;
+        char setup[64];
+        unsigned long counts[N_OUTCOMES];
+        double *latencies = NULL;
+        size_t n_latencies = 0u;
+        double latency = 0.0;
+        double start = 0.0;
+        unsigned long i = 0ul;
+        int outcome = 0;
+        int opt = 0;
+
+
+        memset(&params, 0, sizeof(params));
+        memset(counts, 0, sizeof(counts));
+
+        params.baud_rate = 9600ul;
+        params.first_addr = 1u;
+        params.n_slaves = 1u;
+        params.func_code = MODBUS_FUNC_READ_HOLDING_REGISTERS;
+        params.quantity = 10u;
+        params.timeout_msecs = 100;
+        params.n_transactions = 1000ul;
+
+        while ((opt = getopt(argc, argv, "b:a:n:f:r:q:t:c:v")) != -1) {
+                switch (opt) {
+                case 'b': params.baud_rate = strtoul(optarg, NULL, 0); break;
+                case 'a': params.first_addr = (unsigned) strtoul(optarg, NULL, 0); break;
+                case 'n': params.n_slaves = (unsigned) strtoul(optarg, NULL, 0); break;
+                case 'f': params.func_code = (unsigned) strtoul(optarg, NULL, 0); break;
+                case 'r': params.start_reg = (unsigned) strtoul(optarg, NULL, 0); break;
+                case 'q': params.quantity = (unsigned) strtoul(optarg, NULL, 0); break;
+                case 't': params.timeout_msecs = atoi(optarg); break;
+                case 'c': params.n_transactions = strtoul(optarg, NULL, 0); break;
+                case 'v': params.is_verify = true; break;
+
+                default:
+                        optind = argc;
+                        break;
+                }
+        }
+
+        if (optind != argc - 1 || params.n_slaves == 0u || params.first_addr == 0u
+                        || params.first_addr + params.n_slaves > 248u
+                        || (params.func_code != MODBUS_FUNC_READ_HOLDING_REGISTERS
+                            && params.func_code != MODBUS_FUNC_READ_INPUT_REGISTERS)
+                        || params.quantity == 0u || params.quantity > MAX_QUANTITY
+                        || params.start_reg > 0xffffu || params.timeout_msecs <= 0
+                        || params.n_transactions == 0ul) {
+
+                fprintf(stderr, "usage: %s [-b BAUD] [-a ADDR] [-n N] [-f 3|4] [-r REG] [-q 1..%d] "
+                        "[-t MSECS] [-c N] [-v] DEVICE\n", argv[0], MAX_QUANTITY);
+                return EXIT_FAILURE;
+        }
+
+        /* NOTE: Same parameters string as MODBUS_RTU_PARAMS, DE pin lands in register shim */
+        host_uart_bind(1u, argv[optind]);
+        snprintf(setup, sizeof(setup), "uart=UART1:%lu@8N1,de_port=PORTL:0", params.baud_rate);
+
+        if (!modbus_rtu_setup(&rtu, setup)) {
+                fprintf(stderr, "%s: can't setup ModBus RTU with \"%s\"\n", argv[0], setup);
+                return EXIT_FAILURE;
+        }
+
+        if ((latencies = calloc(params.n_transactions, sizeof(double))) == NULL)
+                return EXIT_FAILURE;
+
+        resync(&rtu, params.baud_rate);
+        start = serial_now_msecs();
+
+        for (; i < params.n_transactions; ++i) {
+                outcome = transact(&rtu, &params,
+                                   (uint8_t) (params.first_addr + i % params.n_slaves), &latency);
+                counts[outcome]++;
+
+                if (outcome == OUTCOME_OK || outcome == OUTCOME_EXCEPTION)
+                        latencies[n_latencies++] = latency;
+                else
+                        resync(&rtu, params.baud_rate);
+        }
+
+        print_report(&params, counts, latencies, n_latencies, serial_now_msecs() - start);
+        free(latencies);
+
+
+        return (counts[OUTCOME_BAD_RESPONSE] == 0ul) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,500 @@
+/*
+ * Host side ModBus RTU slave simulator for load testing of the master.
+ *
+ * Usage: modbus-slave-sim [OPTIONS] [DEVICE]
+ *
+ *      -n N            number of slaves (1)
+ *      -a ADDR         address of the first slave, others follow it (1)
+ *      -r N            number of registers of every slave (64)
+ *      -m FILE         register map, lines of "<slave> <register> <value>"
+ *      -l MIN[:MAX]    response latency in milliseconds, uniformly random in range (0)
+ *      -e PERCENT      replies with "slave device busy" exception
+ *      -c PERCENT      replies with corrupted CRC
+ *      -d PERCENT      requests left without reply
+ *      -b BAUD         baud rate of DEVICE and inter-frame gap (9600)
+ *      -s SEED         seed of the random generator
+ *
+ * Without DEVICE a pseudo-terminal is created and its name is printed, the master is
+ * pointed to it. Pseudo-terminal transfers instantly, so time the request and response
+ * would take on the wire at BAUD is added to latency. With DEVICE (e.g. USB-RS485
+ * adapter) slaves answer on a real bus.
+ * Supported functions are 0x03, 0x04 (read registers), 0x06 and 0x10 (write registers).
+ * Registers without a value in the map read as (slave << 8 | register).
+ * Statistics are printed on exit (SIGINT or SIGTERM).
+ */
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "crc16.h"
+#include "modbus-rtu.h"
+#include "serial.h"
+
+/* NOTE: Longest RTU frame */
+#define FRAME_SIZE 256
+
+#define MAX_READ_QUANTITY 125u
+#define MAX_WRITE_QUANTITY 123u
+
+struct slave_sim {
+        uint8_t first_addr;
+        unsigned n_slaves;
+        unsigned n_regs;
+        uint16_t *regs;
+
+        /* NOTE: Zero on real bus, character time at configured baud rate on pseudo-terminal */
+        double wire_char_msecs;
+
+        unsigned latency_min;
+        unsigned latency_max;
+        unsigned exception_percent;
+        unsigned crc_percent;
+        unsigned drop_percent;
+
+        unsigned long n_requests;
+        unsigned long n_replies;
+        unsigned long n_exceptions;
+        unsigned long n_corrupted;
+        unsigned long n_dropped;
+        unsigned long n_bad_frames;
+        unsigned long n_foreign;
+};
+
+static volatile sig_atomic_t is_running = 1;
+
+static void on_signal(int signum)
+{
+        (void) signum;
+        is_running = 0;
+}
+
+static uint16_t *slave_regs(struct slave_sim *sim, uint8_t addr)
+{
+        if (addr < sim->first_addr || addr - sim->first_addr >= (int) sim->n_slaves)
+                return NULL;
+
+
+        return &sim->regs[(size_t) (addr - sim->first_addr) * sim->n_regs];
+}
+
+static bool roll(unsigned percent)
+{
+        return (unsigned) (rand() % 100) < percent;
+}
+
+static bool load_map(struct slave_sim *sim, const char *path)
+{
+        FILE *f = NULL;
+        char line[128];
+        unsigned slave = 0u;
+        unsigned reg = 0u;
+        unsigned value = 0u;
+        unsigned line_num = 0u;
+        uint16_t *regs = NULL;
+
+
+        if ((f = fopen(path, "r")) == NULL) {
+                fprintf(stderr, "%s: %s\n", path, strerror(errno));
+                return false;
+        }
+
+        while (fgets(line, sizeof(line), f) != NULL) {
+                line_num++;
+
+                if (line[0] == '#' || line[strspn(line, " \t\r\n")] == '\0')
+                        continue;
+
+                if (sscanf(line, "%u %u %i", &slave, &reg, &value) != 3 || slave > 0xffu
+                                || (regs = slave_regs(sim, (uint8_t) slave)) == NULL
+                                || reg >= sim->n_regs || value > 0xffffu) {
+
+                        fprintf(stderr, "%s:%u: bad register map entry\n", path, line_num);
+                        fclose(f);
+                        return false;
+                }
+
+                regs[reg] = (uint16_t) value;
+        }
+
+        fclose(f);
+
+
+        return true;
+}
+
+static size_t put_u16(uint8_t *buf, size_t offset, uint16_t value)
+{
+        buf[offset++] = (uint8_t) (value >> 8);
+        buf[offset++] = (uint8_t) (value & 0xffu);
+
+        return offset;
+}
+
+static uint16_t get_u16(const uint8_t *buf)
+{
+        return (uint16_t) ((buf[0] << 8) | buf[1]);
+}
+
+static size_t put_exception(uint8_t *resp, uint8_t func_code, uint8_t except_code)
+{
+        resp[1] = (uint8_t) (func_code | 0x80u);
+        resp[2] = except_code;
+
+        return 3u;
+}
+
+/* Expected request size by function code, 0 if it is not known yet */
+static size_t request_size(const uint8_t *req, size_t size)
+{
+        if (size < 2u)
+                return 0u;
+
+        switch (req[1]) {
+        case MODBUS_FUNC_WRITE_MULTIPLE_COILS:
+        case MODBUS_FUNC_WRITE_MULTIPLE_REGISTERS:
+                return (size < 7u) ? 0u : 9u + req[6];
+
+        default:
+                break;
+        }
+
+
+        return 8u;
+}
+
+/* Builds response without CRC, returns its size */
+static size_t handle_request(struct slave_sim *sim, const uint8_t *req, size_t size,
+                             uint8_t *resp)
+{
+        uint16_t *regs = NULL;
+        uint16_t start = 0u;
+        uint16_t quantity = 0u;
+        size_t offset = 0u;
+        size_t i = 0u;
+
+
+        regs = slave_regs(sim, req[0]);
+        resp[0] = req[0];
+        resp[1] = req[1];
+
+        start = get_u16(&req[2]);
+        quantity = get_u16(&req[4]);
+
+        switch (req[1]) {
+        case MODBUS_FUNC_READ_HOLDING_REGISTERS:
+        case MODBUS_FUNC_READ_INPUT_REGISTERS:
+                if (quantity == 0u || quantity > MAX_READ_QUANTITY)
+                        return put_exception(resp, req[1], MODBUS_EXCEPT_ILLEGAL_DATA_VALUE);
+
+                if ((unsigned) start + quantity > sim->n_regs)
+                        return put_exception(resp, req[1], MODBUS_EXCEPT_ILLEGAL_DATA_ADDR);
+
+                resp[2] = (uint8_t) (quantity * 2u);
+                offset = 3u;
+                for (; i < quantity; ++i)
+                        offset = put_u16(resp, offset, regs[start + i]);
+
+                return offset;
+
+        case MODBUS_FUNC_WRITE_SINGLE_REGISTER:
+                if (start >= sim->n_regs)
+                        return put_exception(resp, req[1], MODBUS_EXCEPT_ILLEGAL_DATA_ADDR);
+
+                /* NOTE: Response echoes the request */
+                regs[start] = quantity;
+                memcpy(resp, req, 6u);
+                return 6u;
+
+        case MODBUS_FUNC_WRITE_MULTIPLE_REGISTERS:
+                if (quantity == 0u || quantity > MAX_WRITE_QUANTITY || req[6] != quantity * 2u
+                                || size != 9u + req[6]) {
+
+                        return put_exception(resp, req[1], MODBUS_EXCEPT_ILLEGAL_DATA_VALUE);
+                }
+
+                if ((unsigned) start + quantity > sim->n_regs)
+                        return put_exception(resp, req[1], MODBUS_EXCEPT_ILLEGAL_DATA_ADDR);
+
+                for (; i < quantity; ++i)
+                        regs[start + i] = get_u16(&req[7u + 2u * i]);
+
+                memcpy(resp, req, 6u);
+                return 6u;
+
+        default:
+                break;
+        }
+
+
+        return put_exception(resp, req[1], MODBUS_EXCEPT_ILLEGAL_FUNC);
+}
+
+static void sleep_msecs(double msecs)
+{
+        struct timespec ts;
+
+
+        ts.tv_sec = (time_t) (msecs / 1000.0);
+        ts.tv_nsec = (long) ((msecs - (double) ts.tv_sec * 1000.0) * 1000000.0);
+
+        while (nanosleep(&ts, &ts) != 0 && errno == EINTR && is_running)
+                ;
+}
+
+static void handle_frame(struct slave_sim *sim, int fd, const uint8_t *req, size_t size)
+{
+        uint8_t resp[FRAME_SIZE];
+        uint16_t crc_reg = CRC16_REG_INITIALIZER;
+        size_t resp_size = 0u;
+        unsigned latency = 0u;
+
+
+        if (size < 4u) {
+                sim->n_bad_frames++;
+                return;
+        }
+
+        crc16_update(&crc_reg, req, size - 2u);
+        if (crc_reg != (uint16_t) (req[size - 2u] | (req[size - 1u] << 8))) {
+                sim->n_bad_frames++;
+                return;
+        }
+
+        /* NOTE: Broadcast and requests to other devices on the bus are not answered */
+        if (slave_regs(sim, req[0]) == NULL) {
+                sim->n_foreign++;
+                return;
+        }
+
+        sim->n_requests++;
+
+        if (roll(sim->drop_percent)) {
+                sim->n_dropped++;
+                return;
+        }
+
+        if (roll(sim->exception_percent)) {
+                resp[0] = req[0];
+                resp_size = put_exception(resp, req[1], MODBUS_EXCEPT_SLAVE_DEV_BUSY);
+                sim->n_exceptions++;
+        } else
+                resp_size = handle_request(sim, req, size, resp);
+
+        crc_reg = CRC16_REG_INITIALIZER;
+        crc16_update(&crc_reg, resp, resp_size);
+        resp[resp_size++] = (uint8_t) (crc_reg & 0xffu);
+        resp[resp_size++] = (uint8_t) (crc_reg >> 8);
+
+        if (roll(sim->crc_percent)) {
+                resp[resp_size - 1u] ^= 0x01u;
+                sim->n_corrupted++;
+        }
+
+        latency = sim->latency_min;
+        if (sim->latency_max > sim->latency_min)
+                latency += (unsigned) rand() % (sim->latency_max - sim->latency_min + 1u);
+
+        sleep_msecs((double) latency + (double) (size + resp_size) * sim->wire_char_msecs);
+
+        if (write(fd, resp, resp_size) != (ssize_t) resp_size)
+                fprintf(stderr, "// write: %s\n", strerror(errno));
+
+        sim->n_replies++;
+}
+
+static void run(struct slave_sim *sim, int fd, int gap_msecs)
+{
+        struct pollfd pfd;
+        uint8_t frame[FRAME_SIZE];
+        size_t size = 0u;
+        size_t expected = 0u;
+        ssize_t n = 0;
+        int ready = 0;
+
+
+        pfd.fd = fd;
+        pfd.events = POLLIN;
+
+        while (is_running) {
+                /* NOTE: Frame ends when it has expected size or after silence on the line */
+                ready = poll(&pfd, 1, (size > 0u) ? gap_msecs : 200);
+                if (ready < 0 && errno != EINTR)
+                        break;
+
+                if (ready <= 0) {
+                        if (size > 0u)
+                                handle_frame(sim, fd, frame, size);
+
+                        size = 0u;
+                        continue;
+                }
+
+                if ((n = read(fd, &frame[size], sizeof(frame) - size)) <= 0) {
+                        /* NOTE: Pseudo-terminal reports hangup while nobody holds it open */
+                        sleep_msecs(10.0);
+                        continue;
+                }
+
+                size += (size_t) n;
+
+                while ((expected = request_size(frame, size)) != 0u && size >= expected) {
+                        handle_frame(sim, fd, frame, expected);
+
+                        size -= expected;
+                        memmove(frame, &frame[expected], size);
+                }
+
+                if (size == sizeof(frame)) {
+                        sim->n_bad_frames++;
+                        size = 0u;
+                }
+        }
+}
+
+static bool parse_latency(struct slave_sim *sim, const char *arg)
+{
+        int n = 0;
+
+
+        n = sscanf(arg, "%u:%u", &sim->latency_min, &sim->latency_max);
+        if (n == 1)
+                sim->latency_max = sim->latency_min;
+
+
+        return n >= 1 && sim->latency_max >= sim->latency_min;
+}
+
+static int open_pty(int *slave_fd, unsigned long baud_rate)
+{
+        int fd = -1;
+        const char *name = NULL;
+
+
+        if ((fd = posix_openpt(O_RDWR | O_NOCTTY)) < 0 || grantpt(fd) != 0 || unlockpt(fd) != 0)
+                return -1;
+
+        if ((name = ptsname(fd)) == NULL)
+                return -1;
+
+        /* NOTE: Slave side is kept open in raw mode, so nothing is echoed before master opens it */
+        if ((*slave_fd = serial_open(name, baud_rate)) < 0)
+                return -1;
+
+        printf("%s\n", name);
+        fflush(stdout);
+
+
+        return fd;
+}
+
+int main(int argc, char **argv)
+{
+        struct slave_sim sim;
+        unsigned long baud_rate = 9600ul;
+        unsigned first_addr = 1u;
+        unsigned seed = 0u;
+        const char *map_path = NULL;
+        int fd = -1;
+        int slave_fd = -1;
+        int gap_msecs = 0;
+        int opt = 0;
+        size_t i = 0u;
+
+
+        memset(&sim, 0, sizeof(sim));
+        sim.n_slaves = 1u;
+        sim.n_regs = 64u;
+        seed = (unsigned) time(NULL);
+
+        while ((opt = getopt(argc, argv, "n:a:r:m:l:e:c:d:b:s:")) != -1) {
+                switch (opt) {
+                case 'n': sim.n_slaves = (unsigned) strtoul(optarg, NULL, 0); break;
+                case 'a': first_addr = (unsigned) strtoul(optarg, NULL, 0); break;
+                case 'r': sim.n_regs = (unsigned) strtoul(optarg, NULL, 0); break;
+                case 'm': map_path = optarg; break;
+                case 'e': sim.exception_percent = (unsigned) strtoul(optarg, NULL, 0); break;
+                case 'c': sim.crc_percent = (unsigned) strtoul(optarg, NULL, 0); break;
+                case 'd': sim.drop_percent = (unsigned) strtoul(optarg, NULL, 0); break;
+                case 'b': baud_rate = strtoul(optarg, NULL, 0); break;
+                case 's': seed = (unsigned) strtoul(optarg, NULL, 0); break;
+                case 'l':
+                        if (!parse_latency(&sim, optarg)) {
+                                fprintf(stderr, "%s: bad latency \"%s\"\n", argv[0], optarg);
+                                return EXIT_FAILURE;
+                        }
+                        break;
+
+                default:
+                        fprintf(stderr, "usage: %s [-n N] [-a ADDR] [-r N] [-m FILE] [-l MIN[:MAX]] "
+                                "[-e %%] [-c %%] [-d %%] [-b BAUD] [-s SEED] [DEVICE]\n", argv[0]);
+                        return EXIT_FAILURE;
+                }
+        }
+
+        if (sim.n_slaves == 0u || first_addr == 0u || first_addr + sim.n_slaves > 248u
+                        || sim.n_regs == 0u || sim.n_regs > 0x10000u) {
+
+                fprintf(stderr, "%s: slaves must have addresses 1..247 and 1..65536 registers\n", argv[0]);
+                return EXIT_FAILURE;
+        }
+
+        sim.first_addr = (uint8_t) first_addr;
+        sim.regs = calloc((size_t) sim.n_slaves * sim.n_regs, sizeof(uint16_t));
+        if (sim.regs == NULL)
+                return EXIT_FAILURE;
+
+        for (; i < (size_t) sim.n_slaves * sim.n_regs; ++i) {
+                sim.regs[i] = (uint16_t) (((first_addr + i / sim.n_regs) << 8)
+                                          | ((i % sim.n_regs) & 0xffu));
+        }
+
+        if (map_path != NULL && !load_map(&sim, map_path))
+                return EXIT_FAILURE;
+
+        if (optind < argc)
+                fd = serial_open(argv[optind], baud_rate);
+        else {
+                fd = open_pty(&slave_fd, baud_rate);
+                sim.wire_char_msecs = serial_char_msecs(baud_rate);
+        }
+
+        if (fd < 0) {
+                fprintf(stderr, "%s: can't open %s: %s\n", argv[0],
+                        (optind < argc) ? argv[optind] : "pseudo-terminal", strerror(errno));
+                return EXIT_FAILURE;
+        }
+
+        srand(seed);
+        signal(SIGINT, on_signal);
+        signal(SIGTERM, on_signal);
+
+        /* NOTE: RTU frames are separated by 3.5 character times of silence */
+        gap_msecs = (int) (serial_char_msecs(baud_rate) * 3.5 + 1.0);
+
+        run(&sim, fd, gap_msecs);
+
+        fprintf(stderr, "// %lu requests, %lu replies, %lu exceptions, %lu corrupted, "
+                "%lu dropped, %lu bad frames, %lu for other slaves\n",
+                sim.n_requests, sim.n_replies, sim.n_exceptions, sim.n_corrupted,
+                sim.n_dropped, sim.n_bad_frames, sim.n_foreign);
+
+        if (slave_fd >= 0)
+                close(slave_fd);
+
+        close(fd);
+        free(sim.regs);
+
+
+        return EXIT_SUCCESS;
+}
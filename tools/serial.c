@@ -0,0 +1,84 @@
+#include <fcntl.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "serial.h"
+
+static bool baud_to_speed(unsigned long baud_rate, speed_t *speed)
+{
+        static const struct {
+                unsigned long baud_rate;
+                speed_t speed;
+        } speeds[] = {
+                { 1200ul, B1200 }, { 2400ul, B2400 }, { 4800ul, B4800 }, { 9600ul, B9600 },
+                { 19200ul, B19200 }, { 38400ul, B38400 }, { 57600ul, B57600 },
+                { 115200ul, B115200 }
+        };
+
+        size_t i = 0u;
+
+
+        for (; i < sizeof(speeds) / sizeof(speeds[0]); ++i) {
+                if (speeds[i].baud_rate == baud_rate) {
+                        *speed = speeds[i].speed;
+                        return true;
+                }
+        }
+
+
+        return false;
+}
+
+bool serial_set_raw(int fd, unsigned long baud_rate)
+{
+        struct termios tio;
+        speed_t speed = B0;
+
+
+        if (!baud_to_speed(baud_rate, &speed) || tcgetattr(fd, &tio) != 0)
+                return false;
+
+        cfmakeraw(&tio);
+        tio.c_cflag |= (tcflag_t) (CLOCAL | CREAD);
+        tio.c_cc[VMIN] = 0;
+        tio.c_cc[VTIME] = 0;
+
+        cfsetispeed(&tio, speed);
+        cfsetospeed(&tio, speed);
+
+
+        return tcsetattr(fd, TCSANOW, &tio) == 0;
+}
+
+int serial_open(const char *path, unsigned long baud_rate)
+{
+        int fd = -1;
+
+
+        if ((fd = open(path, O_RDWR | O_NOCTTY)) < 0)
+                return -1;
+
+        if (!serial_set_raw(fd, baud_rate)) {
+                close(fd);
+                return -1;
+        }
+
+
+        return fd;
+}
+
+double serial_char_msecs(unsigned long baud_rate)
+{
+        /* NOTE: Start bit, 8 data bits and stop bit */
+        return 10.0 * 1000.0 / (double) baud_rate;
+}
+
+double serial_now_msecs(void)
+{
+        struct timespec ts;
+
+
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return (double) ts.tv_sec * 1000.0 + (double) ts.tv_nsec / 1000000.0;
+}
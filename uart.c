@@ -5,12 +5,13 @@
 #include <avr/interrupt.h>
 #include <avr/pgmspace.h>
 #include <avr/cpufunc.h>
+#include <util/atomic.h>
 
-/*
- * TODO: Framing error detection (Parity checking)
- */
-
+#include "board.h"
 #include "uart.h"
+#include "mem-pool.h"
+#include "profile.h"
+#include "latency.h"
 
 #define FLAG_IS_SET(mask, flag) (((mask) & (flag)) == (flag))
 
@@ -26,11 +27,12 @@
 
 #define IDLE_LOOP_IF_NOT(value) IDLE_LOOP_IF(!(value))
 
+#define UART_PARAMS_SIZE 32
+
+#define UART_ENUM(n, rx_vect, udre_vect) UART##n,
+
 enum {
-        UART0 = 0,
-        UART1,
-        UART2,
-        UART3,
+        BOARD_UART_LIST(UART_ENUM)
 
         N_UART_DEVICES
 };
@@ -39,54 +41,67 @@ static struct uart *cstdin_dev = NULL;
 static struct uart *cstdout_dev = NULL;
 static struct uart *cstderr_dev = NULL;
 
-static struct uart_hw hw_devices[N_UART_DEVICES] = {
-        { .reg = {&UCSR0A, &UCSR0B, &UCSR0C, &UBRR0H, &UBRR0L, &UDR0} },
-        { .reg = {&UCSR1A, &UCSR1B, &UCSR1C, &UBRR1H, &UBRR1L, &UDR1} },
-        { .reg = {&UCSR2A, &UCSR2B, &UCSR2C, &UBRR2H, &UBRR2L, &UDR2} },
-        { .reg = {&UCSR3A, &UCSR3B, &UCSR3C, &UBRR3H, &UBRR3L, &UDR3} }
+struct uart_hw_registers {
+        volatile uint8_t *ucsrxa_addr;
+        volatile uint8_t *ucsrxb_addr;
+        volatile uint8_t *ucsrxc_addr;
+        volatile uint8_t *ubrrxh_addr;
+        volatile uint8_t *ubrrxl_addr;
+        volatile uint8_t *udrx_addr;
+};
+
+/* NOTE: Only FIFOs and counters live in SRAM, register map is in PROGMEM */
+static struct uart_hw hw_devices[N_UART_DEVICES];
+
+#define UART_REGISTERS(n, rx_vect, udre_vect) \
+        [UART##n] = {&UCSR##n##A, &UCSR##n##B, &UCSR##n##C, &UBRR##n##H, &UBRR##n##L, &UDR##n},
+
+static struct uart_hw_registers const hw_registers[N_UART_DEVICES] PROGMEM = {
+        BOARD_UART_LIST(UART_REGISTERS)
 };
 
+#define HW_REG(hw, name) \
+        (*(volatile uint8_t *) pgm_read_ptr(&hw_registers[(hw)->index].name##_addr))
+
 static bool uart_hw_setup(struct uart_hw *hw,
                           unsigned long baud_rate,
                           unsigned frame_size,
                           char parity_sign,
                           unsigned n_stop_bits)
 {
-        struct uart_hw_registers *reg = NULL;
         uint16_t ubrr_value = 0u;
 
 
-        reg = &hw->reg;
-
         fifo_buffer_init(&hw->rx_fifo, hw->_rx_fifo_buf, UART_HW_RX_FIFO_SIZE);
         fifo_buffer_init(&hw->tx_fifo, hw->_tx_fifo_buf, UART_HW_TX_FIFO_SIZE);
+        memset(&hw->stats, 0, sizeof(struct uart_stats));
 
         /* Clear control registers */
-        *( reg->ucsrxa_addr ) = (uint8_t) 0u;
-        *( reg->ucsrxb_addr ) = (uint8_t) 0u;
-        *( reg->ucsrxc_addr ) = (uint8_t) 0u;
+        HW_REG(hw, ucsrxa) = (uint8_t) 0u;
+        HW_REG(hw, ucsrxb) = (uint8_t) 0u;
+        HW_REG(hw, ucsrxc) = (uint8_t) 0u;
 
         /* Calculate and set baud rate */
         ubrr_value = (uint16_t) round(((double) F_CPU / (16.0 * (double) baud_rate)) - 1.0);
 
-        *( reg->ubrrxl_addr ) = (uint8_t)(ubrr_value & 0xff);
-        *( reg->ubrrxh_addr ) = (uint8_t)(ubrr_value >> 8);
+        HW_REG(hw, ubrrxl) = (uint8_t)(ubrr_value & 0xff);
+        HW_REG(hw, ubrrxh) = (uint8_t)(ubrr_value >> 8);
 
         /* Set number of stop bits */
         /* NOTE: By default we use one stop bit */
         if (n_stop_bits == 2u) {
-                *( reg->ucsrxc_addr ) |= (uint8_t)(_BV(USBS0));
+                HW_REG(hw, ucsrxc) |= (uint8_t)(_BV(USBS0));
         }
 
         /* Set frame format */
         if (frame_size == 8u) {
-                *( reg->ucsrxc_addr ) |= (uint8_t)(_BV(UCSZ01) | _BV(UCSZ00));
+                HW_REG(hw, ucsrxc) |= (uint8_t)(_BV(UCSZ01) | _BV(UCSZ00));
         } else if (frame_size == 7u) {
-                *( reg->ucsrxc_addr ) |= (uint8_t)(_BV(UCSZ01));
+                HW_REG(hw, ucsrxc) |= (uint8_t)(_BV(UCSZ01));
         }
 
         /* Enable transmitter / receiver */
-        *( reg->ucsrxb_addr ) |= (uint8_t)(_BV(TXEN0) | _BV(RXEN0));
+        HW_REG(hw, ucsrxb) |= (uint8_t)(_BV(TXEN0) | _BV(RXEN0));
 
 
         return true;
@@ -94,39 +109,39 @@ static bool uart_hw_setup(struct uart_hw *hw,
 
 static void uart_hw_intr_tx_enable(struct uart_hw *hw)
 {
-        *( hw->reg.ucsrxb_addr ) |= (uint8_t)(_BV(UDRIE0));
+        HW_REG(hw, ucsrxb) |= (uint8_t)(_BV(UDRIE0));
 }
 
 static void uart_hw_intr_rx_enable(struct uart_hw *hw)
 {
-        *( hw->reg.ucsrxb_addr ) |= (uint8_t)(_BV(RXCIE0));
+        HW_REG(hw, ucsrxb) |= (uint8_t)(_BV(RXCIE0));
 }
 
 static void uart_hw_intr_tx_disable(struct uart_hw *hw)
 {
-        *( hw->reg.ucsrxb_addr ) &= (uint8_t) ~(_BV(UDRIE0));
+        HW_REG(hw, ucsrxb) &= (uint8_t) ~(_BV(UDRIE0));
 }
 
 static void uart_hw_intr_rx_disable(struct uart_hw *hw)
 {
-        *( hw->reg.ucsrxb_addr ) &= (uint8_t) ~(_BV(RXCIE0));
+        HW_REG(hw, ucsrxb) &= (uint8_t) ~(_BV(RXCIE0));
 }
 
 static bool uart_hw_is_udr_empty(struct uart_hw *hw)
 {
-        return (bool) (*( hw->reg.ucsrxa_addr ) & _BV(UDRIE0));
+        return (bool) (HW_REG(hw, ucsrxa) & _BV(UDRIE0));
 }
 
 static bool uart_hw_is_tx_complete(struct uart_hw *hw)
 {
-        return (bool) (*( hw->reg.ucsrxa_addr ) & _BV(TXC0));
+        return (bool) (HW_REG(hw, ucsrxa) & _BV(TXC0));
 }
 
 static void uart_hw_clear_txc(struct uart_hw *hw)
 {
         /* NOTE: TXC bit may be cleared by setting one to its position */
 
-        *( hw->reg.ucsrxa_addr ) |= (uint8_t) (_BV(TXC0));
+        HW_REG(hw, ucsrxa) |= (uint8_t) (_BV(TXC0));
 }
 
 static inline bool is_parity_sign(int parity_sign)
@@ -167,9 +182,8 @@ static inline bool is_supported_baud_rate(unsigned long baud_rate)
         return false;
 }
 
-bool uart_setup(struct uart *dev, const char *params)
+bool uart_parse_params(struct uart_params *params, const char *str)
 {
-        struct uart_hw *hw = NULL;
         unsigned dev_num = 0u;
         unsigned long baud_rate = 0u;
         unsigned frame_size = 0u;
@@ -177,20 +191,41 @@ bool uart_setup(struct uart *dev, const char *params)
         unsigned n_stop_bits = 0u;
 
 
-        memset(dev, 0, sizeof(struct uart));
+        memset(params, 0, sizeof(struct uart_params));
 
-        if (sscanf_P(params, PSTR("UART%u:%lu@%u%c%u"), &dev_num, &baud_rate, &frame_size,
+        if (sscanf_P(str, PSTR("UART%u:%lu@%u%c%u"), &dev_num, &baud_rate, &frame_size,
                      &parity_sign, &n_stop_bits) != 5) {
 
                 return false;
         }
 
-        if (dev_num < N_UART_DEVICES && is_parity_sign(parity_sign)
-                        && is_supported_frame_size(frame_size)
-                        && is_supported_n_stop_bits(n_stop_bits)
-                        && is_supported_baud_rate(baud_rate)) {
+        if (dev_num > 0xffu || frame_size > 0xffu || n_stop_bits > 0xffu)
+                return false;
+
+        params->baud_rate = (uint32_t) baud_rate;
+        params->dev_num = (uint8_t) dev_num;
+        params->frame_size = (uint8_t) frame_size;
+        params->parity_sign = parity_sign;
+        params->n_stop_bits = (uint8_t) n_stop_bits;
 
-                hw = &hw_devices[dev_num];
+
+        return true;
+}
+
+bool uart_setup_params(struct uart *dev, const struct uart_params *params)
+{
+        struct uart_hw *hw = NULL;
+
+
+        memset(dev, 0, sizeof(struct uart));
+
+        if (params->dev_num < N_UART_DEVICES && is_parity_sign(params->parity_sign)
+                        && is_supported_frame_size(params->frame_size)
+                        && is_supported_n_stop_bits(params->n_stop_bits)
+                        && is_supported_baud_rate(params->baud_rate)) {
+
+                hw = &hw_devices[params->dev_num];
+                hw->index = params->dev_num;
                 dev->hw = hw;
 
                 /* Setup hardware controll functions */
@@ -207,8 +242,8 @@ bool uart_setup(struct uart *dev, const char *params)
                 dev->intr_rx_disable(hw);
                 dev->intr_tx_disable(hw);
 
-                if (dev->setup(hw, baud_rate, frame_size,
-                               parity_sign, n_stop_bits)) {
+                if (dev->setup(hw, params->baud_rate, params->frame_size,
+                               params->parity_sign, params->n_stop_bits)) {
 
                         dev->intr_rx_enable(hw);
                         return true;
@@ -219,13 +254,56 @@ bool uart_setup(struct uart *dev, const char *params)
         return false;
 }
 
+bool uart_setup(struct uart *dev, const char *params)
+{
+        struct uart_params parsed;
+
+
+        memset(dev, 0, sizeof(struct uart));
+
+        if (!uart_parse_params(&parsed, params))
+                return false;
+
+
+        return uart_setup_params(dev, &parsed);
+}
+
+bool uart_parse_params_P(struct uart_params *params, const char *str)
+{
+        size_t mark = 0u;
+        char *buf = NULL;
+        bool retval = false;
+
+
+        memset(params, 0, sizeof(struct uart_params));
+
+        mark = mem_arena_get_mark(&mem_scratch);
+
+        if ((buf = (char *) mem_arena_alloc(&mem_scratch, UART_PARAMS_SIZE)) != NULL) {
+                strncpy_P(buf, str, UART_PARAMS_SIZE - 1);
+                buf[UART_PARAMS_SIZE - 1] = '\0';
+
+                retval = uart_parse_params(params, buf);
+        }
+
+        mem_arena_release(&mem_scratch, mark);
+
+
+        return retval;
+}
+
 bool uart_setup_P(struct uart *dev, const char *params)
 {
-        char buf[32] = {0, };
+        struct uart_params parsed;
+
+
+        memset(dev, 0, sizeof(struct uart));
+
+        if (!uart_parse_params_P(&parsed, params))
+                return false;
 
 
-        strncpy_P(buf, params, sizeof(buf) - 1);
-        return uart_setup(dev, buf);
+        return uart_setup_params(dev, &parsed);
 }
 
 int uart_poll(struct uart *dev, int event_mask)
@@ -306,7 +384,7 @@ static inline void write_byte_sync(struct uart *dev, uint8_t byte)
         IDLE_LOOP_IF_NOT(dev->is_udr_empty(hw));
 
         dev->clear_txc(hw);
-        *( hw->reg.udrx_addr ) = byte;
+        HW_REG(hw, udrx) = byte;
 
         IDLE_LOOP_IF_NOT(dev->is_tx_complete(hw));
 }
@@ -371,7 +449,7 @@ enum uart_result uart_write_byte(struct uart *dev, uint8_t byte, int flags)
         return UART_RESULT_OK;
 }
 
-enum uart_result uart_read_chunk(struct uart *dev, struct mem_chunk *chunk, int flags)
+static inline enum uart_result read_bytes(struct uart *dev, struct mem_chunk *chunk, int flags)
 {
         size_t i = 0u;
         uint8_t *bytes = NULL;
@@ -392,7 +470,7 @@ enum uart_result uart_read_chunk(struct uart *dev, struct mem_chunk *chunk, int
         return result;
 }
 
-enum uart_result uart_write_chunk(struct uart *dev, struct mem_chunk *chunk, int flags)
+static inline enum uart_result write_bytes(struct uart *dev, struct mem_chunk *chunk, int flags)
 {
         size_t i = 0u;
         uint8_t *bytes = NULL;
@@ -410,14 +488,96 @@ enum uart_result uart_write_chunk(struct uart *dev, struct mem_chunk *chunk, int
 
 
         chunk->offset = i;
+        return result;
+}
 
-        if (!FLAG_IS_SET(flags, UART_FLAG_SYNC_TXC))
+static inline void write_done(struct uart *dev, int flags)
+{
+        /* NOTE: Non-blocking writes leave the FIFO to UDRE interrupt instead of waiting */
+        if (FLAG_IS_SET(flags, UART_FLAG_NONBLOCK))
+                dev->intr_tx_enable(dev->hw);
+        else if (!FLAG_IS_SET(flags, UART_FLAG_SYNC_TXC))
                 uart_flush(dev);
+}
+
+enum uart_result uart_read_chunk(struct uart *dev, struct mem_chunk *chunk, int flags)
+{
+        return read_bytes(dev, chunk, flags);
+}
+
+enum uart_result uart_write_chunk(struct uart *dev, struct mem_chunk *chunk, int flags)
+{
+        enum uart_result result = UART_RESULT_OK;
+
+
+        result = write_bytes(dev, chunk, flags);
+        write_done(dev, flags);
+
+
+        return result;
+}
+
+enum uart_result uart_read_chain(struct uart *dev, struct mem_chain *chain, int flags)
+{
+        enum uart_result result = UART_RESULT_OK;
+
+
+        for (; chain->index < chain->n_chunks; ++chain->index) {
+                result = read_bytes(dev, &chain->chunks[chain->index], flags);
+                if (result != UART_RESULT_OK)
+                        break;
+        }
+
+
+        return result;
+}
+
+enum uart_result uart_write_chain(struct uart *dev, struct mem_chain *chain, int flags)
+{
+        enum uart_result result = UART_RESULT_OK;
+
+
+        /* NOTE: Chunks go into TX FIFO back to back, flushed once at the end */
+        for (; chain->index < chain->n_chunks; ++chain->index) {
+                result = write_bytes(dev, &chain->chunks[chain->index], flags);
+                if (result != UART_RESULT_OK)
+                        break;
+        }
+
+        write_done(dev, flags);
 
 
         return result;
 }
 
+void uart_clear_tx_complete(struct uart *dev)
+{
+        dev->clear_txc(dev->hw);
+}
+
+bool uart_is_tx_complete(struct uart *dev)
+{
+        /*
+         * NOTE: TXC is set once shift register runs dry with nothing in UDR. UDRE interrupt
+         *       refills UDR well within a character time, so it isn't set mid-stream.
+         */
+        return fifo_buffer_is_empty(&dev->hw->tx_fifo) && dev->is_tx_complete(dev->hw);
+}
+
+void uart_get_stats(struct uart *dev, struct uart_stats *stats)
+{
+        LATENCY_ATOMIC_BLOCK(LATENCY_SITE_UART_STATS) {
+                *stats = dev->hw->stats;
+        }
+}
+
+void uart_clear_stats(struct uart *dev)
+{
+        LATENCY_ATOMIC_BLOCK(LATENCY_SITE_UART_STATS) {
+                memset(&dev->hw->stats, 0, sizeof(struct uart_stats));
+        }
+}
+
 #define DEFINE_PUTC(name)                                                                       \
         static int name##_putc(char ch, FILE *stream)                                           \
         {                                                                                       \
@@ -448,75 +608,103 @@ static int cstdin_getc(FILE *stream)
         return (int) byte;
 }
 
+/* NOTE: Streams are static, fdevopen() would pull malloc() into the firmware */
+static FILE cstdin_file = FDEV_SETUP_STREAM(NULL, cstdin_getc, _FDEV_SETUP_READ);
+static FILE cstdout_file = FDEV_SETUP_STREAM(cstdout_putc, NULL, _FDEV_SETUP_WRITE);
+static FILE cstderr_file = FDEV_SETUP_STREAM(cstderr_putc, NULL, _FDEV_SETUP_WRITE);
+
 void uart_bind_to_cstdin(struct uart *dev)
 {
-        if (stdin != NULL)
-                fclose(stdin);
-
         cstdin_dev = dev;
-        stdin = fdevopen(NULL, cstdin_getc);
+        stdin = &cstdin_file;
 }
 
 void uart_bind_to_cstdout(struct uart *dev)
 {
-        if (stdout != NULL)
-                fclose(stdout);
-
         cstdout_dev = dev;
-        stdout = fdevopen(cstdout_putc, NULL);
+        stdout = &cstdout_file;
 }
 
 void uart_bind_to_cstderr(struct uart *dev)
 {
-        if (stderr != NULL)
-                fclose(stderr);
-
         cstderr_dev = dev;
-        stderr = fdevopen(cstderr_putc, NULL);
+        stderr = &cstderr_file;
 }
 
-static inline __attribute__((always_inline)) void isr_udre_handler(struct uart_hw *hw)
+/*
+ * NOTE: ISRs get register addresses as constants, so accesses compile to plain lds/sts
+ *       without table lookups.
+ */
+static inline __attribute__((always_inline)) void isr_udre_handler(struct uart_hw *hw,
+                                                                   volatile uint8_t *ucsrxb,
+                                                                   volatile uint8_t *udrx)
 {
         uint8_t byte = 0u;
 
 
+        LATENCY_ISR_BEGIN(LATENCY_SITE_UART_UDRE_ISR);
+        PROFILE_BEGIN(PROFILE_REGION_UART_UDRE_ISR);
+
         if (fifo_buffer_get_byte(&hw->tx_fifo, &byte))
-                *( hw->reg.udrx_addr ) = byte;
+                *udrx = byte;
 
         else
-                uart_hw_intr_tx_disable(hw);
+                *ucsrxb &= (uint8_t) ~(_BV(UDRIE0));
+
+        PROFILE_END(PROFILE_REGION_UART_UDRE_ISR);
+        LATENCY_ISR_END(LATENCY_SITE_UART_UDRE_ISR);
 }
 
-#define DEFINE_UDRE_ISR(dev_num)                                \
-        ISR(USART##dev_num##_UDRE_vect)                         \
-        {                                                       \
-                isr_udre_handler(&hw_devices[UART##dev_num]);   \
+#define DEFINE_UDRE_ISR(dev_num, rx_vect, udre_vect)                   \
+        ISR(udre_vect)                                                  \
+        {                                                               \
+                isr_udre_handler(&hw_devices[UART##dev_num],            \
+                                 &UCSR##dev_num##B, &UDR##dev_num);     \
         }
 
-DEFINE_UDRE_ISR(0)
-DEFINE_UDRE_ISR(1)
-DEFINE_UDRE_ISR(2)
-DEFINE_UDRE_ISR(3)
+BOARD_UART_LIST(DEFINE_UDRE_ISR)
 
-static inline __attribute__((always_inline)) void isr_rx_handler(struct uart_hw *hw)
+static inline __attribute__((always_inline)) void isr_rx_handler(struct uart_hw *hw,
+                                                                 volatile uint8_t *ucsrxa,
+                                                                 volatile uint8_t *ucsrxb,
+                                                                 volatile uint8_t *udrx)
 {
+        uint8_t status = 0u;
         uint8_t byte = 0u;
 
 
-        byte = *( hw->reg.udrx_addr );
+        LATENCY_ISR_BEGIN(LATENCY_SITE_UART_RX_ISR);
+        PROFILE_BEGIN(PROFILE_REGION_UART_RX_ISR);
+
+        /* NOTE: Error flags are valid only until UDR is read */
+        status = *ucsrxa;
+        byte = *udrx;
+
+        if (status & _BV(FE0))
+                hw->stats.n_frame_errors++;
+
+        if (status & _BV(DOR0))
+                hw->stats.n_overruns++;
+
+        if (status & _BV(UPE0))
+                hw->stats.n_parity_errors++;
+
+        if (!fifo_buffer_put_byte(&hw->rx_fifo, byte)) {
+                hw->stats.n_dropped++;
+                *ucsrxb &= (uint8_t) ~(_BV(RXCIE0));
+        }
 
-        if (!fifo_buffer_put_byte(&hw->rx_fifo, byte))
-                uart_hw_intr_rx_disable(hw);
+        PROFILE_END(PROFILE_REGION_UART_RX_ISR);
+        LATENCY_ISR_END(LATENCY_SITE_UART_RX_ISR);
 }
 
-#define DEFINE_RX_ISR(dev_num)                                  \
-        ISR(USART##dev_num##_RX_vect)                           \
-        {                                                       \
-                isr_rx_handler(&hw_devices[UART##dev_num]);     \
+#define DEFINE_RX_ISR(dev_num, rx_vect, udre_vect)                     \
+        ISR(rx_vect)                                                    \
+        {                                                               \
+                isr_rx_handler(&hw_devices[UART##dev_num],              \
+                               &UCSR##dev_num##A, &UCSR##dev_num##B,    \
+                               &UDR##dev_num);                          \
         }
 
-DEFINE_RX_ISR(0)
-DEFINE_RX_ISR(1)
-DEFINE_RX_ISR(2)
-DEFINE_RX_ISR(3)
+BOARD_UART_LIST(DEFINE_RX_ISR)
 
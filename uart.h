@@ -53,13 +53,21 @@ enum uart_result {
         UART_RESULT_WILL_BLOCK
 };
 
-struct uart_hw_registers {
-        volatile uint8_t *ucsrxa_addr;
-        volatile uint8_t *ucsrxb_addr;
-        volatile uint8_t *ucsrxc_addr;
-        volatile uint8_t *ubrrxh_addr;
-        volatile uint8_t *ubrrxl_addr;
-        volatile uint8_t *udrx_addr;
+/* NOTE: Receiver errors, counted in RX interrupt */
+struct uart_stats {
+        uint16_t n_frame_errors;
+        uint16_t n_overruns;
+        uint16_t n_parity_errors;
+        uint16_t n_dropped;
+};
+
+/* NOTE: Pre-parsed "UART<n>:<baud>@<size><parity><stop>" parameters, as kept in EEPROM config */
+struct uart_params {
+        uint32_t baud_rate;
+        uint8_t dev_num;
+        uint8_t frame_size;
+        char parity_sign;
+        uint8_t n_stop_bits;
 };
 
 struct uart_hw {
@@ -69,7 +77,10 @@ struct uart_hw {
         struct fifo_buffer tx_fifo;
         struct fifo_buffer rx_fifo;
 
-        struct uart_hw_registers reg;
+        struct uart_stats stats;
+
+        /* NOTE: Device number, indexes register table without pointer arithmetic */
+        uint8_t index;
 };
 
 struct uart {
@@ -85,6 +96,9 @@ struct uart {
         void (*clear_txc)(struct uart_hw *);
 };
 
+bool uart_parse_params(struct uart_params *params, const char *str);
+bool uart_parse_params_P(struct uart_params *params, const char *str);
+bool uart_setup_params(struct uart *dev, const struct uart_params *params);
 bool uart_setup(struct uart *dev, const char *params);
 bool uart_setup_P(struct uart *dev, const char *params);
 int uart_poll(struct uart *dev, int event_mask);
@@ -93,6 +107,12 @@ enum uart_result uart_read_byte(struct uart *dev, uint8_t *store, int flags);
 enum uart_result uart_write_byte(struct uart *dev, uint8_t byte, int flags);
 enum uart_result uart_read_chunk(struct uart *dev, struct mem_chunk *chunk, int flags);
 enum uart_result uart_write_chunk(struct uart *dev, struct mem_chunk *chunk, int flags);
+enum uart_result uart_read_chain(struct uart *dev, struct mem_chain *chain, int flags);
+enum uart_result uart_write_chain(struct uart *dev, struct mem_chain *chain, int flags);
+void uart_clear_tx_complete(struct uart *dev);
+bool uart_is_tx_complete(struct uart *dev);
+void uart_get_stats(struct uart *dev, struct uart_stats *stats);
+void uart_clear_stats(struct uart *dev);
 void uart_bind_to_cstdin(struct uart *dev);
 void uart_bind_to_cstdout(struct uart *dev);
 void uart_bind_to_cstderr(struct uart *dev);